@@ -0,0 +1,63 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+using BenchFunc = void (*)();
+
+vector<pair<string, BenchFunc>>& benches();
+
+class BenchRegister
+{
+public:
+    BenchRegister(char const* name, BenchFunc f)
+    {
+        benches().emplace_back(name, f);
+    }
+};
+
+#define BENCH(name)                                                     \
+    static void          bench_##name();                                \
+    static BenchRegister bench_register_##name { #name, bench_##name }; \
+    static void          bench_##name()
+
+// Keeps a result alive so the measured work is not optimized away.
+template<typename T>
+void keep(T const& v)
+{
+    static T volatile sink;
+    sink = v;
+    (void) sink;
+}
+
+// Calls f repeatedly for at least min_ms and prints how many items per second it processed.
+template<typename F>
+double measure(char const* label, double items_per_call, char const* unit, F&& f, uint64_t min_ms = 300)
+{
+    using namespace std::chrono;
+
+    f();
+
+    uint64_t n     = 0;
+    auto     start = steady_clock::now();
+    auto     end   = start;
+    do
+    {
+        f();
+        n++;
+        end = steady_clock::now();
+    } while (duration_cast<milliseconds>(end - start).count() < static_cast<int64_t>(min_ms));
+
+    double sec  = duration<double>(end - start).count();
+    double rate = items_per_call * static_cast<double>(n) / sec;
+    printf("  %-40s %14.0f %s/s %12.3f us/call\n", label, rate, unit, sec * 1e6 / static_cast<double>(n));
+    return rate;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "bench.hpp"
+#include "chunk.hpp"
+#include "db.hpp"
+
+BENCH(chunk_load)
+{
+    int32_t cx = 0;
+    measure("Chunk(ChunkID), generated", 1, "chunks", [&] {
+        Chunk chunk { ChunkID { cx, 0 } };
+        keep(chunk.get_block(BlockID { cx, 0, 0 }));
+        cx += CHUNK_WIDTH;
+    });
+
+    constexpr int32_t n_baked = 256;
+    for (int32_t i = 0; i < n_baked; i++)
+    {
+        ChunkID chunk_id { i * static_cast<int32_t>(CHUNK_WIDTH), 0 };
+        DB::ins().baked.emplace(chunk_id, Chunk::bake(chunk_id));
+    }
+    cx = 0;
+    measure("Chunk(ChunkID), baked", 1, "chunks", [&] {
+        Chunk chunk { ChunkID { cx, 0 } };
+        keep(chunk.get_block(BlockID { cx, 0, 0 }));
+        cx = (cx + CHUNK_WIDTH) % (n_baked * CHUNK_WIDTH);
+    });
+    DB::ins().baked.clear();
+}
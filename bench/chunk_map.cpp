@@ -0,0 +1,73 @@
+#include <random>
+#include <unordered_map>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "world.hpp"
+
+// ChunkMap against the hash map BlockManager kept its chunks in before, over the chunks of the window around the origin.
+BENCH(chunk_map)
+{
+    use_world(World::flat);
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f));
+
+    unordered_map<ChunkID, Chunk*, ChunkID::Hasher> map {};
+    for (Chunk* chunk : block_manager.get_chunks())
+    {
+        map.emplace(chunk->chunk_id, chunk);
+    }
+    printf("  %zu chunks\n", map.size());
+
+    // Blocks all over the window, as the collider, rays and block ticks read them.
+    constexpr size_t n_blocks = 4096;
+    auto             extent   = BlockManager::LOAD_RANGE * static_cast<int32_t>(CHUNK_WIDTH);
+    mt19937          rng { 1 };
+    vector<BlockID>  block_ids {};
+    for (size_t i = 0; i < n_blocks; i++)
+    {
+        block_ids.emplace_back(static_cast<int32_t>(rng() % (2 * extent)) - extent, static_cast<int32_t>(rng() % (2 * extent)) - extent, static_cast<int32_t>(rng() % 128));
+    }
+
+    measure("get_block, unordered_map", n_blocks, "blocks", [&] {
+        uint32_t sum = 0;
+        for (BlockID const& block_id : block_ids)
+        {
+            auto it = map.find(ChunkID { block_id });
+            if (it != map.end())
+                if (BlockData const* block = it->second->get_block(block_id); block != nullptr)
+                    sum += block->type();
+        }
+        keep(sum);
+    });
+    measure("get_block, ChunkMap", n_blocks, "blocks", [&] {
+        uint32_t sum = 0;
+        for (BlockID const& block_id : block_ids)
+        {
+            if (BlockData const* block = block_manager.get_block(block_id); block != nullptr)
+                sum += block->type();
+        }
+        keep(sum);
+    });
+
+    // What the renderer does for every chunk of every frame before drawing it.
+    measure("iterate, unordered_map", static_cast<double>(map.size()), "chunks", [&] {
+        size_t sum = 0;
+        for (auto const& [chunk_id, chunk] : map)
+        {
+            sum += chunk_id.x + chunk->chunk_id.y;
+        }
+        keep(sum);
+    });
+    measure("iterate, ChunkMap", static_cast<double>(map.size()), "chunks", [&] {
+        size_t sum = 0;
+        for (Chunk const* chunk : block_manager.get_chunks())
+        {
+            sum += chunk->chunk_id.x + chunk->chunk_id.y;
+        }
+        keep(sum);
+    });
+
+    block_manager.shutdown();
+    use_world(World::generated);
+}
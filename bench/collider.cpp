@@ -0,0 +1,105 @@
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "collider.hpp"
+
+// Collider::collide before the column heightmaps: the grounded check walks every z from the feet down to 1.
+static Collision collide_scan(BlockManager& block_manager, float radius, float height_u, float height_l, vec3 const& pos)
+{
+    float min_z   = pos.z - height_l;
+    auto  min_x_b = static_cast<int32_t>(floor(pos.x - radius + 0.1f));
+    auto  max_x_b = static_cast<int32_t>(floor(pos.x + radius - 0.1f));
+    auto  min_y_b = static_cast<int32_t>(floor(pos.y - radius + 0.1f));
+    auto  max_y_b = static_cast<int32_t>(floor(pos.y + radius - 0.1f));
+    auto  min_z_b = static_cast<uint8_t>(floor(min_z + 0.1f));
+    auto  max_z_b = static_cast<uint8_t>(floor(pos.z + height_u - 0.1f));
+
+    bool found = false;
+    for (int32_t z = min_z_b; z <= max_z_b; z++)
+        for (int32_t x = min_x_b; x <= max_x_b; x++)
+            for (int32_t y = min_y_b; y <= max_y_b; y++)
+                if (auto const* b = block_manager.get_block(BlockID { x, y, z }); b != nullptr && b->is_solid())
+                    found = true;
+
+    int32_t highest_z_b = 0;
+    for (int32_t z = min_z_b; z > 0; z--)
+        for (int32_t x = min_x_b; x <= max_x_b; x++)
+            for (int32_t y = min_y_b; y <= max_y_b; y++)
+                if (auto const* b = block_manager.get_block(BlockID { x, y, z }); b != nullptr && b->is_solid())
+                    highest_z_b = max(highest_z_b, z + 1);
+
+    auto highest_z = static_cast<float>(highest_z_b);
+    return Collision { found, (min_z - highest_z < 5e-6f) ? highest_z + height_l : NAN };
+}
+
+// Collider::collide with the heightmaps but without ChunkCursor: one hash lookup per cell and per column.
+static Collision collide_lookup(BlockManager& block_manager, float radius, float height_u, float height_l, vec3 const& pos)
+{
+    float min_z   = pos.z - height_l;
+    auto  min_x_b = static_cast<int32_t>(floor(pos.x - radius + 0.1f));
+    auto  max_x_b = static_cast<int32_t>(floor(pos.x + radius - 0.1f));
+    auto  min_y_b = static_cast<int32_t>(floor(pos.y - radius + 0.1f));
+    auto  max_y_b = static_cast<int32_t>(floor(pos.y + radius - 0.1f));
+    auto  min_z_b = static_cast<uint8_t>(floor(min_z + 0.1f));
+    auto  max_z_b = static_cast<uint8_t>(floor(pos.z + height_u - 0.1f));
+
+    bool found = false;
+    for (int32_t z = min_z_b; z <= max_z_b; z++)
+        for (int32_t x = min_x_b; x <= max_x_b; x++)
+            for (int32_t y = min_y_b; y <= max_y_b; y++)
+                if (auto const* b = block_manager.get_block(BlockID { x, y, z }); b != nullptr && b->is_solid())
+                    found = true;
+
+    int32_t highest_z_b = 0;
+    for (int32_t x = min_x_b; x <= max_x_b; x++)
+        for (int32_t y = min_y_b; y <= max_y_b; y++)
+            if (int32_t h = block_manager.ground_height(BlockID { x, y, min_z_b }); h > 1)
+                highest_z_b = max(highest_z_b, h);
+
+    auto highest_z = static_cast<float>(highest_z_b);
+    return Collision { found, (min_z - highest_z < 5e-6f) ? highest_z + height_l : NAN };
+}
+
+BENCH(collider)
+{
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f, 0.f, 0.f));
+
+    // Players standing on the terrain, at every block of a 128 * 128 area.
+    vector<vec3> positions {};
+    for (int32_t x = -64; x < 64; x++)
+    {
+        for (int32_t y = -64; y < 64; y++)
+        {
+            auto ground = static_cast<float>(block_manager.ground_height(BlockID { x, y, 255 }));
+            positions.emplace_back(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f, ground + 1.95f);
+        }
+    }
+
+    Collider collider { 0.3f, 0.0f, 1.95f };
+    measure("collide, z scan", static_cast<double>(positions.size()), "calls", [&] {
+        for (auto const& pos : positions)
+        {
+            auto c = collide_scan(block_manager, 0.3f, 0.0f, 1.95f, pos);
+            keep(c.found);
+            keep(c.grounded);
+        }
+    });
+    measure("collide, heightmap, get_block", static_cast<double>(positions.size()), "calls", [&] {
+        for (auto const& pos : positions)
+        {
+            auto c = collide_lookup(block_manager, 0.3f, 0.0f, 1.95f, pos);
+            keep(c.found);
+            keep(c.grounded);
+        }
+    });
+    measure("collide, heightmap, ChunkCursor", static_cast<double>(positions.size()), "calls", [&] {
+        for (auto const& pos : positions)
+        {
+            auto c = collider.collide(block_manager, pos);
+            keep(c.found);
+            keep(c.grounded);
+        }
+    });
+
+    block_manager.shutdown();
+}
@@ -0,0 +1,70 @@
+#include <random>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "entity.hpp"
+
+BENCH(entity_step)
+{
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f, 0.f, 0.f));
+
+    // 10k entities dropped over 128 * 128 blocks of terrain, half of them mobs walking around, half items that come to
+    // rest and fall asleep.
+    auto spawn = [&](EntityManager& entities) {
+        mt19937                          rng { 1 };
+        uniform_real_distribution<float> coord { -64.f, 64.f }, angle { 0.f, 6.2831853f };
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            float x = coord(rng), y = coord(rng);
+            auto  z = static_cast<float>(block_manager.ground_height(BlockID { static_cast<int32_t>(floor(x)), static_cast<int32_t>(floor(y)), 255 }));
+            bool  mob = i % 2 == 0;
+            auto  e   = entities.add(vec3(x, y, z + 4.f), mob ? 0.3f : 0.125f, mob ? 0.f : 0.25f, mob ? 1.8f : 0.f);
+            if (mob)
+            {
+                float a = angle(rng);
+                entities.set_velocity(e, vec3(cos(a), sin(a), 0.f) * player_speed * 0.5f);
+            }
+        }
+    };
+
+    vector<uint32_t> thread_counts { 1 };
+    if (thread::hardware_concurrency() > 1)
+    {
+        thread_counts.push_back(thread::hardware_concurrency());
+    }
+
+    unordered_set<ChunkID, ChunkID::Hasher> no_changes {};
+    for (uint32_t n_threads : thread_counts)
+    {
+        EntityManager entities {};
+        entities.n_threads = n_threads;
+        spawn(entities);
+
+        // The first 200 steps cover the fall and the items settling.
+        for (int i = 0; i < 200; i++)
+        {
+            entities.step(block_manager, 16.f, no_changes);
+        }
+
+        uint32_t n_asleep = 0;
+        for (uint32_t i = 0; i < entities.size(); i++)
+        {
+            n_asleep += entities.is_asleep(i);
+        }
+        printf("  %u threads, %u of %u entities asleep\n", n_threads, n_asleep, entities.size());
+
+        measure("step, 10k entities", entities.size(), "entities", [&] { entities.step(block_manager, 16.f, no_changes); });
+
+        for (uint32_t i = 0; i < entities.size(); i++)
+        {
+            entities.rest_steps[i] = 0;
+        }
+        measure("step, 10k entities, none asleep", entities.size(), "entities", [&] {
+            entities.step(block_manager, 16.f, no_changes);
+            fill(entities.rest_steps.begin(), entities.rest_steps.end(), 0);
+        });
+    }
+
+    block_manager.shutdown();
+}
@@ -0,0 +1,107 @@
+#include <memory>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "chunk_cursor.hpp"
+#include "job.hpp"
+
+// About a microsecond of work that cannot be optimized away.
+static uint32_t work(uint32_t seed)
+{
+    uint32_t h = seed;
+    for (uint32_t i = 0; i < 400; i++)
+    {
+        h = h * 0x9e37'79b9u + i;
+    }
+    return h;
+}
+
+BENCH(job)
+{
+    vector<uint32_t> thread_counts { 1 };
+    for (uint32_t n : { 2u, 4u, thread::hardware_concurrency() })
+    {
+        if (n > thread_counts.back() && n <= thread::hardware_concurrency())
+            thread_counts.push_back(n);
+    }
+
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f));
+
+    vector<pair<Chunk*, array<Chunk const*, 4>>> meshed {};
+    for (Chunk* chunk : block_manager.get_chunks())
+    {
+        meshed.emplace_back(chunk, ChunkCursor { block_manager, static_cast<int32_t>(chunk->chunk_id.x), static_cast<int32_t>(chunk->chunk_id.y), 0 }.adjacent());
+    }
+
+    for (uint32_t n_threads : thread_counts)
+    {
+        printf("  %u threads\n", n_threads);
+        JobSystem        jobs { n_threads };
+        atomic<uint32_t> sum { 0 };
+
+        measure("run + wait, 10k jobs of 1 us", 10000, "jobs", [&] {
+            JobCounter counter {};
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                jobs.run([&, i] { sum += work(i); }, &counter);
+            }
+            jobs.wait(counter);
+        });
+
+        // Every job spawns two more, so all the work starts in one deque and has to be stolen.
+        measure("spawn tree, 8191 jobs of 1 us", 8191, "jobs", [&] {
+            JobCounter          counter {};
+            function<void(int)> spawn = [&](int depth) {
+                sum += work(static_cast<uint32_t>(depth));
+                if (depth == 0)
+                    return;
+                jobs.run([&, depth] { spawn(depth - 1); }, &counter);
+                jobs.run([&, depth] { spawn(depth - 1); }, &counter);
+            };
+            jobs.run([&] { spawn(12); }, &counter);
+            jobs.wait(counter);
+        });
+
+        // The main thread's share between frames: it runs what the pool has not taken yet, a millisecond at a time.
+        measure("run_for 1 ms slices, 10k jobs of 1 us", 10000, "jobs", [&] {
+            JobCounter counter {};
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                jobs.run([&, i] { sum += work(i); }, &counter);
+            }
+            while (jobs.run_for(chrono::microseconds(1000)) != 0)
+            {
+            }
+            jobs.wait(counter);
+        });
+
+        // Each job of a chain only starts once the one before it is done.
+        measure("run_after, 64 chains of 64 jobs of 1 us", 64 * 64, "jobs", [&] {
+            constexpr uint32_t       n = 64;
+            unique_ptr<JobCounter[]> counters { new JobCounter[n * n] };
+            for (uint32_t c = 0; c < n; c++)
+            {
+                jobs.run([&, c] { sum += work(c); }, &counters[c * n]);
+                for (uint32_t k = 1; k < n; k++)
+                {
+                    jobs.run_after(counters[c * n + k - 1], [&, k] { sum += work(k); }, &counters[c * n + k]);
+                }
+            }
+            for (uint32_t i = 0; i < n * n; i++)
+            {
+                jobs.wait(counters[i]);
+            }
+        });
+
+        measure("parallel_for, Chunk::update", static_cast<double>(meshed.size()), "chunks", [&] {
+            jobs.parallel_for(static_cast<uint32_t>(meshed.size()), 1, n_threads, [&](uint32_t i) {
+                meshed[i].first->update(array<Chunk const*, 4> { meshed[i].second });
+            });
+        });
+
+        keep(sum.load());
+    }
+
+    block_manager.shutdown();
+}
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "chunk.hpp"
+
+BENCH(light)
+{
+    int32_t cx = 0;
+    measure("Chunk(ChunkID), lit", 1, "chunks", [&] {
+        Chunk chunk { ChunkID { cx, 0 } };
+        keep(chunk.get_light(0, 0, 0));
+        cx += CHUNK_WIDTH;
+    });
+
+    {
+        BlockManager block_manager {};
+        measure(
+            "update(), 21 * 21 chunks with seams",
+            21 * 21,
+            "chunks",
+            [&] {
+                block_manager.shutdown();
+                block_manager.update(vec3(0.f));
+            },
+            1000);
+        block_manager.shutdown();
+    }
+
+    // A cave in a block of stone, lit by the sky through a shaft and by a lamp on its floor.
+    constexpr int32_t n = 48, z0 = 64, z1 = 120, r = 12;
+    constexpr int32_t cz = 80;
+
+    BlockManager block_manager {};
+    block_manager.fill(BlockID { 0, 0, z0 }, BlockID { n - 1, n - 1, z1 }, BlockData { BlockType::stone_block });
+    block_manager.carve_sphere(BlockID { n / 2, n / 2, cz }, r);
+    block_manager.fill(BlockID { n / 2, n / 2, cz }, BlockID { n / 2, n / 2, z1 }, BlockData {});
+    block_manager.add_block(BlockID { n / 2 - 6, n / 2, cz - 8 }, BlockData { BlockType::lamp });
+
+    BlockID pillar { n / 2 + 4, n / 2 - 4, cz - 6 };
+    measure("add_block + del_block in a lit cave", 2, "edits", [&] {
+        block_manager.add_block(BlockID { pillar }, BlockData { BlockType::stone_block });
+        block_manager.del_block(pillar);
+    });
+
+    BlockID lamp { n / 2 - 6, n / 2, cz - 8 };
+    measure("del_block + add_block of the lamp", 2, "edits", [&] {
+        block_manager.del_block(lamp);
+        block_manager.add_block(BlockID { lamp }, BlockData { BlockType::lamp });
+    });
+
+    BlockID shaft { n / 2, n / 2, z1 };
+    measure("closing and opening the shaft", 2, "edits", [&] {
+        block_manager.add_block(BlockID { shaft }, BlockData { BlockType::stone_block });
+        block_manager.del_block(shaft);
+    });
+
+    block_manager.shutdown();
+}
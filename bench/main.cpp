@@ -0,0 +1,25 @@
+#include <cstring>
+
+#include "bench.hpp"
+
+vector<pair<string, BenchFunc>>& benches()
+{
+    static vector<pair<string, BenchFunc>> b {};
+    return b;
+}
+
+// craft_bench [filter]: runs every benchmark whose name contains filter.
+int main(int argc, char** argv)
+{
+    char const* filter = argc > 1 ? argv[1] : "";
+    for (auto const& [name, f] : benches())
+    {
+        if (name.find(filter) == string::npos)
+        {
+            continue;
+        }
+        printf("%s\n", name.c_str());
+        f();
+    }
+    return 0;
+}
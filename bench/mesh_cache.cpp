@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <filesystem>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "mesh_cache.hpp"
+#include "world.hpp"
+
+BENCH(mesh_cache)
+{
+    using namespace std::chrono;
+
+    // Loading the generated world at the origin with CHUNK_UPDATE_BUDGET_US a frame, without the cache, into an empty
+    // cache, and again as on reloading the world with the cache the first load filled. A chunk is visible once it is
+    // loaded and meshed, its time to visible is counted from the first frame.
+    string dir = (filesystem::temp_directory_path() / "craft_bench_mesh_cache").string();
+    filesystem::remove_all(dir);
+    use_world(World::generated);
+
+    for (char const* run : { "off", "cold", "warm" })
+    {
+        if (string(run) != "off")
+            MeshCache::ins().init(dir);
+        uint64_t hits = MeshCache::ins().get_hits(), misses = MeshCache::ins().get_misses();
+
+        BlockManager block_manager {};
+
+        vector<float>                           latencies {};
+        float                                   longest = 0.f;
+        unordered_set<ChunkID, ChunkID::Hasher> seen {};
+        size_t n_chunks = (2 * BlockManager::LOAD_RANGE + 1) * (2 * BlockManager::LOAD_RANGE + 1);
+        auto   start    = steady_clock::now();
+        while (seen.size() < n_chunks)
+        {
+            auto frame = steady_clock::now();
+            block_manager.update(vec3(0.f), microseconds(CHUNK_UPDATE_BUDGET_US));
+            longest  = max(longest, duration<float, milli>(steady_clock::now() - frame).count());
+            float ms = duration<float, milli>(steady_clock::now() - start).count();
+            for (int32_t dx = -BlockManager::LOAD_RANGE; dx <= BlockManager::LOAD_RANGE; dx++)
+            {
+                for (int32_t dy = -BlockManager::LOAD_RANGE; dy <= BlockManager::LOAD_RANGE; dy++)
+                {
+                    ChunkID chunk_id = ChunkID {}.add(dx, dy);
+                    if (seen.count(chunk_id) == 0 && block_manager.get_chunk(chunk_id) != nullptr &&
+                        block_manager.get_chunks_need_update().count(chunk_id) == 0)
+                    {
+                        latencies.push_back(ms);
+                        seen.insert(chunk_id);
+                    }
+                }
+            }
+        }
+
+        sort(latencies.begin(), latencies.end());
+        float sum = 0.f;
+        for (float l : latencies)
+            sum += l;
+        hits   = MeshCache::ins().get_hits() - hits;
+        misses = MeshCache::ins().get_misses() - misses;
+        printf("  cache %-4s: time to visible %7.1f ms mean %7.1f ms p95 %7.1f ms all, longest frame %5.1f ms, %llu hits %llu misses (%.0f%% hit)\n",
+               run,
+               sum / static_cast<float>(latencies.size()),
+               latencies[latencies.size() * 95 / 100],
+               latencies.back(),
+               longest,
+               static_cast<unsigned long long>(hits),
+               static_cast<unsigned long long>(misses),
+               hits + misses == 0 ? 0. : 100. * static_cast<double>(hits) / static_cast<double>(hits + misses));
+
+        block_manager.shutdown();
+        MeshCache::ins().shutdown();
+    }
+
+    filesystem::remove_all(dir);
+}
@@ -0,0 +1,81 @@
+#include <array>
+#include <cmath>
+
+#include "bench.hpp"
+#include "perlin.hpp"
+
+// Terrain needs two noise values per column, see generate() in chunk_load.cpp.
+BENCH(perlin_columns)
+{
+    int32_t cx = 0;
+    measure("noise (scalar double)", 256, "columns", [&] {
+        double s = 0.0;
+        for (int32_t x = cx; x < cx + 16; x++)
+        {
+            for (int32_t y = 0; y < 16; y++)
+            {
+                s += PerlinNoise::noise(x / 96.0, y / 96.0, 0.0);
+                s += PerlinNoise::noise(x / 3.0, y / 3.0, 0.0);
+            }
+        }
+        keep(s);
+        cx += 16;
+    });
+
+    cx = 0;
+    measure("noise_grid (16x16, 2 octaves)", 256, "columns", [&] {
+        array<float, 256> h, h_stone;
+        PerlinNoise::noise_grid(cx, 0, 16, 16, 96, h.data());
+        PerlinNoise::noise_grid(cx, 0, 16, 16, 3, h_stone.data());
+        keep(h[cx & 255] + h_stone[cx & 255]);
+        cx += 16;
+    });
+}
+
+BENCH(perlin_3d)
+{
+    int32_t cz = 0;
+    measure("noise (scalar double)", 16 * 16 * 16, "samples", [&] {
+        double s = 0.0;
+        for (int32_t x = 0; x < 16; x++)
+            for (int32_t y = 0; y < 16; y++)
+                for (int32_t z = cz; z < cz + 16; z++)
+                    s += PerlinNoise::noise(x / 16.0, y / 16.0, z / 16.0);
+        keep(s);
+        cz += 16;
+    });
+
+    cz = 0;
+    measure("noise_grid (16x16x16)", 16 * 16 * 16, "samples", [&] {
+        array<float, 16 * 16 * 16> n;
+        PerlinNoise::noise_grid(0, 0, cz, 16, 16, 16, 16, n.data());
+        keep(n[cz & 4095]);
+        cz += 16;
+    });
+}
+
+// How often float lanes round differently from doubles in the terrain height; generate() recomputes those columns.
+BENCH(perlin_rounding)
+{
+    uint64_t columns = 0, differ = 0;
+    float    error   = 0.f;
+    for (int32_t cx = -32; cx < 32; cx++)
+    {
+        for (int32_t cy = -32; cy < 32; cy++)
+        {
+            array<float, 256> h;
+            PerlinNoise::noise_grid(cx * 16, cy * 16, 16, 16, 96, h.data());
+            for (int32_t i = 0; i < 16; i++)
+            {
+                for (int32_t j = 0; j < 16; j++)
+                {
+                    double n = PerlinNoise::noise((cx * 16 + i) / 96.0, (cy * 16 + j) / 96.0, 0.0);
+                    error    = max(error, static_cast<float>(abs(n - h[i * 16 + j])));
+                    differ += round(n * 24.0) != round(h[i * 16 + j] * 24.f);
+                    columns++;
+                }
+            }
+        }
+    }
+    printf("  %llu columns, %llu rounded differently, max error %g (tolerance %g)\n", static_cast<unsigned long long>(columns), static_cast<unsigned long long>(differ), error, PerlinNoise::NOISE_GRID_TOLERANCE);
+}
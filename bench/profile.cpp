@@ -0,0 +1,42 @@
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "chunk_cursor.hpp"
+#include "profile.hpp"
+
+BENCH(profile)
+{
+    Profiler& profiler = Profiler::ins();
+    bool      enabled  = profiler.is_enabled();
+
+    uint32_t n = 0;
+    profiler.set_enabled(false);
+    measure("empty zone, disabled", 1000, "zones", [&] {
+        for (int i = 0; i < 1000; i++)
+        {
+            PROFILE_ZONE("empty");
+            keep(n++);
+        }
+    });
+    profiler.set_enabled(true);
+    measure("empty zone, enabled", 1000, "zones", [&] {
+        for (int i = 0; i < 1000; i++)
+        {
+            PROFILE_ZONE("empty");
+            keep(n++);
+        }
+    });
+
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f));
+    Chunk* chunk = block_manager.get_chunk(ChunkID { 0, 0 });
+    for (bool on : { false, true })
+    {
+        profiler.set_enabled(on);
+        measure(on ? "Chunk::update, enabled" : "Chunk::update, disabled", 1, "chunks", [&] { chunk->update(ChunkCursor { block_manager, 0, 0, 0 }.adjacent()); });
+    }
+
+    measure("write_trace, full ring", static_cast<double>(Profiler::RING_SIZE), "zones", [&] { profiler.write_trace("/dev/null"); });
+
+    block_manager.shutdown();
+    profiler.set_enabled(enabled);
+}
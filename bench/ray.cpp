@@ -0,0 +1,112 @@
+#include <random>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "ray.hpp"
+
+// Ray::cast_block before ChunkCursor: one BlockManager::get_block, so one hash lookup, per cell.
+static optional<array<BlockID, 2>> cast_block_lookup(BlockManager& block_manager, vec3 const& p0, vec3 const& dir, float max_distance)
+{
+    array<int32_t, 3> curr {}, step {};
+    array<float, 3>   next_distance {};
+
+    auto compute_next_distance = [&](int i) { next_distance[i] = (static_cast<float>(curr[i] + (step[i] < 0 ? 0 : 1)) - p0[i]) / dir[i]; };
+    for (int i = 0; i < 3; i++)
+    {
+        curr[i] = static_cast<int32_t>(floor(p0[i]));
+        if (dir[i] != 0.f)
+        {
+            step[i] = dir[i] > 0.f ? 1 : -1;
+            compute_next_distance(i);
+        }
+        else
+        {
+            next_distance[i] = 4294967295.f;
+        }
+    }
+
+    for (;;)
+    {
+        int i = 0;
+        if (next_distance[1] < next_distance[i])
+            i = 1;
+        if (next_distance[2] < next_distance[i])
+            i = 2;
+        if (next_distance[i] > max_distance)
+            break;
+
+        curr[i] += step[i];
+        BlockID block_id { curr[0], curr[1], curr[2] };
+        if (block_manager.get_block(block_id) != nullptr)
+        {
+            curr[i] -= step[i];
+            return { { { block_id, BlockID { curr[0], curr[1], curr[2] } } } };
+        }
+        compute_next_distance(i);
+    }
+    return nullopt;
+}
+
+BENCH(ray)
+{
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f, 0.f, 0.f));
+
+    // Player::update's ray: 24 blocks from eye height, standing on land or on the water, mostly looking around rather than
+    // down so that most rays run their full length.
+    mt19937                          rng { 1 };
+    uniform_real_distribution<float> coord { -64.f, 64.f }, angle { 0.f, 6.2831853f }, pitch { 0.3f, 1.8f };
+
+    vector<pair<vec3, vec3>> rays {};
+    for (int i = 0; i < 4096; i++)
+    {
+        float x = coord(rng), y = coord(rng), rot = angle(rng), p = pitch(rng);
+        auto  z = static_cast<float>(max<uint16_t>(24, block_manager.ground_height(BlockID { static_cast<int32_t>(floor(x)), static_cast<int32_t>(floor(y)), 255 })));
+        rays.emplace_back(vec3(x, y, z + 1.95f), vec3(sin(p) * cos(rot), sin(p) * sin(rot), cos(p)));
+    }
+
+    measure("cast_block 24, get_block per cell", static_cast<double>(rays.size()), "rays", [&] {
+        for (auto const& [p0, dir] : rays)
+            keep(cast_block_lookup(block_manager, p0, dir, 24).has_value());
+    });
+    measure("cast_block 24, ChunkCursor", static_cast<double>(rays.size()), "rays", [&] {
+        for (auto const& [p0, dir] : rays)
+            keep(Ray::cast_block(block_manager, p0, dir, 24).has_value());
+    });
+
+    block_manager.shutdown();
+}
+
+BENCH(ray_batch)
+{
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f, 0.f, 0.f));
+
+    // Line of sight and explosion rays: any direction from 1 to 16 blocks above the terrain.
+    mt19937                          rng { 1 };
+    uniform_real_distribution<float> coord { -64.f, 64.f }, above { 1.f, 16.f }, unit { -1.f, 1.f };
+
+    vector<pair<vec3, vec3>> rays {};
+    while (rays.size() < 10000)
+    {
+        vec3 dir(unit(rng), unit(rng), unit(rng));
+        if (length(dir) < 0.01f)
+            continue;
+        float x = coord(rng), y = coord(rng);
+        auto  z = static_cast<float>(max<uint16_t>(24, block_manager.ground_height(BlockID { static_cast<int32_t>(floor(x)), static_cast<int32_t>(floor(y)), 255 })));
+        rays.emplace_back(vec3(x, y, z + above(rng)), normalize(dir));
+    }
+
+    measure("cast_block 64, one by one", static_cast<double>(rays.size()), "rays", [&] {
+        for (auto const& [p0, dir] : rays)
+            keep(Ray::cast_block(block_manager, p0, dir, 64).has_value());
+    });
+
+    vector<optional<array<BlockID, 2>>> results {};
+    measure("cast_blocks 64, 10k rays", static_cast<double>(rays.size()), "rays", [&] {
+        Ray::cast_blocks(block_manager, rays, 64, results);
+        keep(results.back().has_value());
+    });
+
+    block_manager.shutdown();
+}
@@ -0,0 +1,34 @@
+#include "bench.hpp"
+#include "block_manager.hpp"
+
+BENCH(region_edit)
+{
+    constexpr int32_t n = 64, r = 32;
+
+    BlockManager per_block {}, region {};
+
+    measure("add_block, 64^3 box", n * n * n, "blocks", [&] {
+        for (int32_t x = 0; x < n; x++)
+            for (int32_t y = 0; y < n; y++)
+                for (int32_t z = 64; z < 64 + n; z++)
+                    per_block.add_block(BlockID { x, y, z }, BlockData { BlockType::stone_block });
+    });
+    measure("fill, 64^3 box", n * n * n, "blocks", [&] {
+        region.fill(BlockID { 0, 0, 64 }, BlockID { n - 1, n - 1, 64 + n - 1 }, BlockData { BlockType::stone_block });
+    });
+
+    double volume = 4.0 / 3.0 * 3.14159265 * r * r * r;
+    measure("del_block, radius 32 sphere", volume, "blocks", [&] {
+        for (int32_t x = -r; x <= r; x++)
+            for (int32_t y = -r; y <= r; y++)
+                for (int32_t z = -r; z <= r; z++)
+                    if (x * x + y * y + z * z <= r * r)
+                        per_block.del_block(BlockID { n / 2 + x, n / 2 + y, 96 + z });
+    });
+    measure("carve_sphere, radius 32", volume, "blocks", [&] {
+        region.carve_sphere(BlockID { n / 2, n / 2, 96 }, r);
+    });
+
+    per_block.shutdown();
+    region.shutdown();
+}
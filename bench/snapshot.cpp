@@ -0,0 +1,120 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+
+BENCH(snapshot)
+{
+    using namespace std::chrono;
+
+    BlockManager block_manager {};
+    block_manager.update(vec3(0.f));
+
+    // Memory of the snapshots of the whole window, against the blocks they copy.
+    vector<shared_ptr<ChunkSnapshot const>> snapshots {};
+    auto                                    start = steady_clock::now();
+    for (Chunk* chunk : block_manager.get_chunks())
+    {
+        snapshots.push_back(chunk->snapshot());
+    }
+    double first_us = duration<double, micro>(steady_clock::now() - start).count() / static_cast<double>(snapshots.size());
+
+    auto section_bytes = [](vector<shared_ptr<ChunkSnapshot const>> const& all) {
+        unordered_set<BlockSection const*> seen {};
+        for (auto const& snapshot : all)
+            for (auto const& section : snapshot->sections)
+                if (section != nullptr)
+                    seen.insert(section.get());
+        return seen.size() * sizeof(BlockSection);
+    };
+
+    size_t n_chunks = snapshots.size(), bytes = section_bytes(snapshots);
+    printf("  first snapshot() %.1f us per chunk, %.1f KiB per chunk (%.0f%% of the %zu KiB of blocks)\n",
+           first_us,
+           static_cast<double>(bytes) / 1024. / static_cast<double>(n_chunks),
+           100. * static_cast<double>(bytes) / static_cast<double>(n_chunks * sizeof(ChunkBlocks)),
+           sizeof(ChunkBlocks) / 1024);
+
+    // One block edited in every chunk, with the old snapshots still held by readers.
+    for (Chunk* chunk : block_manager.get_chunks())
+    {
+        block_manager.add_block(BlockID { static_cast<int32_t>(chunk->chunk_id.x), static_cast<int32_t>(chunk->chunk_id.y), 200 }, BlockData { BlockType::stone_block });
+        snapshots.push_back(chunk->snapshot());
+    }
+    printf("  after one edit per chunk, old and new snapshots take %.1f KiB per chunk together\n",
+           static_cast<double>(section_bytes(snapshots)) / 1024. / static_cast<double>(n_chunks));
+    snapshots.clear();
+
+    Chunk*  chunk = block_manager.get_chunk(ChunkID { 0, 0 });
+    uint8_t z     = 100;
+    measure("snapshot(), unchanged", 1, "snapshots", [&] { keep(chunk->snapshot()->version); });
+    measure("add_block + snapshot(), one section", 1, "snapshots", [&] {
+        chunk->add_block(BlockID { 0, 0, z }, BlockData { BlockType::stone_block });
+        keep(chunk->snapshot()->version);
+        z = z == 250 ? 100 : z + 1;
+    });
+
+    // Stress: the main thread rewrites a pattern spanning two sections of the chunk and publishes a snapshot after each
+    // step, while readers on other threads check that every snapshot they get holds one whole step, and still does after
+    // the writer moved on.
+    constexpr uint16_t n_cells = 8;
+    auto               cell    = [](uint16_t i) { return BlockID { static_cast<int32_t>(i), static_cast<int32_t>(15 - i), static_cast<uint8_t>(i < 4 ? 40 + i : 200 + i) }; };
+    auto               type    = [](uint64_t step) { return static_cast<uint16_t>(BlockType::grass_block + step % 3); };
+
+    shared_ptr<ChunkSnapshot const> published = chunk->snapshot();
+    uint64_t                        base      = published->version;
+    atomic<bool>                    stop { false };
+    atomic<uint64_t>                n_reads { 0 }, n_bad { 0 };
+
+    auto read = [&] {
+        while (!stop.load(memory_order_relaxed))
+        {
+            shared_ptr<ChunkSnapshot const> snapshot = atomic_load(&published);
+            for (int pass = 0; pass < 2; pass++)
+            {
+                uint64_t step = (snapshot->version - base) / n_cells;
+                for (uint16_t i = 0; i < n_cells; i++)
+                {
+                    n_bad += step != 0 && snapshot->get_block(cell(i)).type() != type(step);
+                }
+                this_thread::yield();
+            }
+            n_reads++;
+        }
+    };
+
+    uint32_t       n_readers = max(2u, thread::hardware_concurrency() - 1);
+    vector<thread> readers {};
+    for (uint32_t r = 0; r < n_readers; r++)
+    {
+        readers.emplace_back(read);
+    }
+
+    uint64_t step = 0;
+    start         = steady_clock::now();
+    while (steady_clock::now() - start < milliseconds(500))
+    {
+        step++;
+        for (uint16_t i = 0; i < n_cells; i++)
+        {
+            chunk->add_block(cell(i), BlockData { type(step) });
+        }
+        atomic_store(&published, chunk->snapshot());
+    }
+    stop = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+
+    printf("  stress: %u readers, %lu writer steps, %lu snapshots read twice, %lu torn or changed reads\n",
+           n_readers,
+           static_cast<unsigned long>(step),
+           static_cast<unsigned long>(n_reads.load()),
+           static_cast<unsigned long>(n_bad.load()));
+
+    block_manager.shutdown();
+}
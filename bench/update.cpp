@@ -0,0 +1,170 @@
+#include <algorithm>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+#include "memory.hpp"
+
+BENCH(update_moving)
+{
+    using namespace std::chrono;
+
+    // Flying along x at half a block per frame crosses a chunk border every 32 frames, each crossing loading a row of 21
+    // chunks and remeshing the rows next to it.
+    constexpr int   n_frames = 2000;
+    constexpr float speed    = 0.5f;
+
+    for (uint32_t budget_us : { 1000000u, 4000u, 2000u })
+    {
+        BlockManager block_manager {};
+        block_manager.update(vec3(0.f));
+
+        vector<double> frames {};
+        size_t         n_late = 0;
+        for (int i = 0; i < n_frames; i++)
+        {
+            vec3 center(static_cast<float>(i) * speed, 0.f, 0.f);
+            auto t = steady_clock::now();
+            block_manager.update(center, microseconds(budget_us));
+            frames.push_back(duration<double, micro>(steady_clock::now() - t).count());
+
+            // Frames where a chunk within two of the player is missing or not meshed yet.
+            ChunkID center_id { static_cast<int32_t>(center.x), static_cast<int32_t>(center.y) };
+            bool    late = false;
+            for (int32_t dx = -2; dx <= 2; dx++)
+            {
+                for (int32_t dy = -2; dy <= 2; dy++)
+                {
+                    ChunkID chunk_id = center_id.add(dx, dy);
+                    late |= block_manager.get_chunk(chunk_id) == nullptr || block_manager.get_chunks_need_update().count(chunk_id) != 0;
+                }
+            }
+            n_late += late;
+        }
+
+        sort(frames.begin(), frames.end());
+        printf("  budget %7u us: %8.0f us p50 %8.0f us p99 %8.0f us max, %zu of %d frames late near the player, %.2f meshes per chunk loaded\n",
+               budget_us,
+               frames[frames.size() / 2],
+               frames[frames.size() * 99 / 100],
+               frames.back(),
+               n_late,
+               n_frames,
+               static_cast<double>(block_manager.get_n_meshed()) / static_cast<double>(block_manager.get_n_loaded()));
+
+        block_manager.shutdown();
+    }
+}
+
+BENCH(update_sprint)
+{
+    using namespace std::chrono;
+
+    // Sprinting along x at a block per 16 ms frame with 1 ms per frame for chunks, looking ahead or to the side. A chunk
+    // enters the view when it comes within the window and the 75 degree field of view, and is visible once it is loaded
+    // and meshed.
+    constexpr int   n_frames = 1500;
+    constexpr float frame_ms = 16.f, speed = 1.f / frame_ms;
+    float           cos_fov = cos(radians(37.5f));
+
+    for (float look : { 0.f, 60.f })
+    {
+        for (bool aware : { false, true })
+        {
+            BlockManager block_manager {};
+            block_manager.update(vec3(0.f));
+
+            vec3 forward(cos(radians(look)), sin(radians(look)), 0.f), velocity(speed, 0.f, 0.f);
+
+            unordered_map<ChunkID, int, ChunkID::Hasher> entered {};
+            unordered_set<ChunkID, ChunkID::Hasher>      seen {};
+            vector<float>                                latencies {};
+            for (int i = 0; i < n_frames; i++)
+            {
+                vec3 center = velocity * (static_cast<float>(i) * frame_ms);
+                if (aware)
+                    block_manager.update(center, forward, velocity, microseconds(1000));
+                else
+                    block_manager.update(center, microseconds(1000));
+
+                ChunkID center_id { static_cast<int32_t>(center.x), static_cast<int32_t>(center.y) };
+                for (int32_t dx = -BlockManager::LOAD_RANGE; dx <= BlockManager::LOAD_RANGE; dx++)
+                {
+                    for (int32_t dy = -BlockManager::LOAD_RANGE; dy <= BlockManager::LOAD_RANGE; dy++)
+                    {
+                        ChunkID chunk_id = center_id.add(dx, dy);
+                        if (seen.count(chunk_id) != 0)
+                            continue;
+
+                        vec2 d = vec2(static_cast<float>(static_cast<int32_t>(chunk_id.x)) + CHUNK_WIDTH / 2.f,
+                                      static_cast<float>(static_cast<int32_t>(chunk_id.y)) + CHUNK_WIDTH / 2.f) -
+                                 vec2(center);
+                        if (entered.count(chunk_id) == 0 && dot(d, vec2(forward)) < cos_fov * length(d))
+                            continue;
+
+                        int  frame   = entered.emplace(chunk_id, i).first->second;
+                        bool visible = block_manager.get_chunk(chunk_id) != nullptr && block_manager.get_chunks_need_update().count(chunk_id) == 0;
+                        if (visible)
+                        {
+                            // Chunks in view from the start are not counted.
+                            if (frame > 0)
+                                latencies.push_back(static_cast<float>(i - frame) * frame_ms);
+                            seen.insert(chunk_id);
+                        }
+                    }
+                }
+            }
+
+            sort(latencies.begin(), latencies.end());
+            float  sum     = 0.f;
+            size_t n_later = 0;
+            for (float l : latencies)
+            {
+                sum += l;
+                n_later += l > 0.f;
+            }
+            printf("  looking %2.0f deg, %-15s time to visible %6.1f ms mean %6.1f ms p95 %6.1f ms max, %zu of %zu chunks late\n",
+                   look,
+                   aware ? "view + velocity" : "distance",
+                   sum / static_cast<float>(latencies.size()),
+                   latencies[latencies.size() * 95 / 100],
+                   latencies.back(),
+                   n_later,
+                   latencies.size());
+
+            block_manager.shutdown();
+        }
+    }
+}
+
+BENCH(update_range)
+{
+    using namespace std::chrono;
+
+    // The window at each load range: the time to fill it, its memory, and the time to unload it down to LOAD_RANGE_MIN.
+    for (int32_t range : { LOAD_RANGE_MIN, 8, BlockManager::LOAD_RANGE, 16 })
+    {
+        BlockManager block_manager {};
+        block_manager.set_range(range);
+
+        auto t = steady_clock::now();
+        block_manager.update(vec3(0.f));
+        double load_ms = duration<double, milli>(steady_clock::now() - t).count();
+        size_t n       = block_manager.get_chunks().size();
+        double mib     = static_cast<double>(Memory::ins().total()) / (1024. * 1024.);
+
+        block_manager.set_range(LOAD_RANGE_MIN);
+        t = steady_clock::now();
+        block_manager.update(vec3(0.f));
+        double unload_ms = duration<double, milli>(steady_clock::now() - t).count();
+
+        printf("  range %2d: %4zu chunks loaded and meshed in %7.1f ms, %7.1f MiB, down to %zu chunks in %6.1f ms\n",
+               range,
+               n,
+               load_ms,
+               mib,
+               block_manager.get_chunks().size(),
+               unload_ms);
+
+        block_manager.shutdown();
+    }
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "bench.hpp"
+#include "block_manager.hpp"
+
+// Ticks until no update is left, reporting the updates run and the longest tick.
+static void run_ticks(char const* label, BlockManager& block_manager, chrono::microseconds budget)
+{
+    using namespace std::chrono;
+
+    size_t n = 0, n_ticks = 0;
+    double longest = 0.0;
+    auto   start   = steady_clock::now();
+    while (block_manager.get_ticks().size() != 0)
+    {
+        auto t = steady_clock::now();
+        n += block_manager.tick(budget);
+        longest = max(longest, duration<double, micro>(steady_clock::now() - t).count());
+        n_ticks++;
+    }
+    double sec = duration<double>(steady_clock::now() - start).count();
+    printf("  %-40s %14.0f updates/s %8zu updates %6zu ticks %8.0f us longest tick\n",
+           label,
+           static_cast<double>(n) / sec,
+           n,
+           n_ticks,
+           longest);
+}
+
+BENCH(water_drain)
+{
+    // A 192 * 192 basin up in the air within the loaded chunks, filled from a grid of sources 12 apart that leaves only the
+    // corners between four sources dry. Removing the sources drains the whole lake.
+    constexpr int32_t n = 192, spacing = 12, z = 160;
+
+    for (uint32_t budget_us : { 2000u, 1000000u })
+    {
+        BlockManager block_manager {};
+        block_manager.update(vec3(n / 2.f, n / 2.f, 0.f));
+
+        block_manager.fill(BlockID { -1, -1, z - 1 }, BlockID { n, n, z }, BlockData { BlockType::stone_block });
+        block_manager.fill(BlockID { 0, 0, z }, BlockID { n - 1, n - 1, z }, BlockData {});
+        for (int32_t x = spacing / 2; x < n; x += spacing)
+            for (int32_t y = spacing / 2; y < n; y += spacing)
+                block_manager.add_block(BlockID { x, y, z }, BlockData { BlockType::water_block });
+
+        printf("  budget %u us\n", budget_us);
+        run_ticks("fill", block_manager, chrono::microseconds(budget_us));
+
+        for (int32_t x = spacing / 2; x < n; x += spacing)
+            for (int32_t y = spacing / 2; y < n; y += spacing)
+                block_manager.del_block(BlockID { x, y, z });
+        run_ticks("drain", block_manager, chrono::microseconds(budget_us));
+
+        block_manager.shutdown();
+    }
+}
@@ -0,0 +1,106 @@
+#include <filesystem>
+#include <random>
+
+#include "bench.hpp"
+#include "chunk_cursor.hpp"
+#include "collider.hpp"
+#include "ray.hpp"
+#include "world.hpp"
+
+// The world core on each synthetic world: meshing, the DB format, rays and collisions.
+BENCH(worlds)
+{
+    DB& db = DB::ins();
+    db.path = (filesystem::temp_directory_path() / "craft_bench_db").string();
+
+    for (World world : WORLDS)
+    {
+        printf("  %s\n", world_name(world));
+        use_world(world);
+
+        BlockManager block_manager {};
+        block_manager.update(vec3(0.f));
+
+        // Meshes are only taken by the renderer, so all of the window's are still there.
+        auto mib = [](MemoryCategory category) { return static_cast<double>(Memory::ins().bytes(category)) / (1024. * 1024.); };
+        printf("  window of %zu chunks: %.1f MiB of chunks, %.1f MiB of light, %.1f MiB of meshes\n",
+               block_manager.get_chunks().size(),
+               mib(MemoryCategory::chunks),
+               mib(MemoryCategory::light),
+               mib(MemoryCategory::meshes));
+
+        Chunk* chunk = block_manager.get_chunk(ChunkID { 0, 0 });
+        measure("Chunk::update", 1, "chunks", [&] { chunk->update(ChunkCursor { block_manager, 0, 0, 0 }.adjacent()); });
+
+        constexpr double n_blocks = CHUNK_WIDTH * CHUNK_WIDTH * 256;
+        vector<uint32_t> data {};
+        measure("marshal, every block of a chunk", n_blocks, "blocks", [&] {
+            data.clear();
+            for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+                for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+                    for (uint16_t z = 0; z < 256; z++)
+                        data.push_back(marshal(x, y, z, chunk->at(x, y, static_cast<uint8_t>(z))));
+            keep(data.back());
+        });
+        measure("unmarshal, every block of a chunk", n_blocks, "blocks", [&] {
+            uint32_t sum = 0;
+            for (uint32_t b : data)
+            {
+                auto [x, y, z, block] = unmarshal(b);
+                sum += x + y + z + block.type();
+            }
+            keep(sum);
+        });
+
+        // Every chunk of the window stored whole, as if edited everywhere.
+        for (Chunk const* c : block_manager.get_chunks())
+        {
+            auto& blocks = db.chunks[c->chunk_id];
+            for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+                for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+                    for (uint16_t z = 0; z < 256; z++)
+                        if (auto const& block = c->at(x, y, static_cast<uint8_t>(z)); !block.is_null())
+                            blocks.push_back(marshal(x, y, z, block));
+        }
+        auto n_chunks = static_cast<double>(db.chunks.size());
+        measure("DB::shutdown, window edited", n_chunks, "chunks", [&] { db.shutdown(); });
+        measure("DB::init, window edited", n_chunks, "chunks", [&] {
+            db.chunks.clear();
+            db.baked.clear();
+            db.init();
+        });
+        db.chunks.clear();
+
+        // Player::update's ray and the player's collider, from the ground at random columns.
+        mt19937                          rng { 1 };
+        uniform_real_distribution<float> coord { -64.f, 64.f }, angle { 0.f, 6.2831853f }, pitch { 0.3f, 1.8f };
+
+        vector<pair<vec3, vec3>> rays {};
+        vector<vec3>             positions {};
+        for (int i = 0; i < 4096; i++)
+        {
+            float x = coord(rng), y = coord(rng), rot = angle(rng), p = pitch(rng);
+            auto  z = static_cast<float>(block_manager.ground_height(BlockID { static_cast<int32_t>(floor(x)), static_cast<int32_t>(floor(y)), 255 }));
+            rays.emplace_back(vec3(x, y, z + 1.95f), vec3(sin(p) * cos(rot), sin(p) * sin(rot), cos(p)));
+            positions.emplace_back(x, y, z + 1.95f);
+        }
+
+        measure("Ray::cast_block 24", static_cast<double>(rays.size()), "rays", [&] {
+            for (auto const& [p0, dir] : rays)
+                keep(Ray::cast_block(block_manager, p0, dir, 24).has_value());
+        });
+
+        Collider collider { 0.3f, 0.0f, 1.95f };
+        measure("Collider::collide", static_cast<double>(positions.size()), "calls", [&] {
+            for (auto const& pos : positions)
+                keep(collider.collide(block_manager, pos).found);
+        });
+
+        block_manager.shutdown();
+    }
+
+    filesystem::remove(db.path);
+    db.path = DB_PATH;
+    db.baked.clear();
+    db.seed = 0;
+}
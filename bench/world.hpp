@@ -0,0 +1,87 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include <array>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "db.hpp"
+
+using namespace std;
+
+/*
+ * Synthetic worlds, the same on every run:
+ *  flat:         stone up to z 64, air above.
+ *  generated:    the terrain generator with WORLD_SEED.
+ *  checkerboard: stone and air alternating along x, y and z up to z 128, every block with all six faces to mesh. The
+ *                worst case for meshing, lighting and rays.
+ */
+enum class World
+{
+    flat,
+    generated,
+    checkerboard,
+};
+
+constexpr array<World, 3> WORLDS { World::flat, World::generated, World::checkerboard };
+constexpr uint32_t        WORLD_SEED = 1;
+
+// Chunks around the origin that use_world() covers, the window of a BlockManager updated at the origin.
+constexpr int32_t WORLD_RADIUS = BlockManager::LOAD_RANGE + 1;
+
+inline char const* world_name(World world)
+{
+    switch (world)
+    {
+    case World::flat:
+        return "flat";
+    case World::generated:
+        return "generated";
+    case World::checkerboard:
+        return "checkerboard";
+    }
+    return "";
+}
+
+// Makes the chunks within WORLD_RADIUS of the origin load as world from now on, through DB::baked for the synthetic
+// ones. Player edits in the DB are dropped.
+inline void use_world(World world)
+{
+    DB& db  = DB::ins();
+    db.seed = WORLD_SEED;
+    db.chunks.clear();
+    db.baked.clear();
+    if (world == World::generated)
+        return;
+
+    // Runs of type << 16 | length per column, see Chunk::bake. Chunks start at multiples of 16, so the parity of the
+    // checkerboard is the same in all of them.
+    vector<uint32_t> runs {};
+    for (uint32_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint32_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            if (world == World::flat)
+            {
+                runs.push_back(static_cast<uint32_t>(BlockType::stone_block) << 16u | 64u);
+                runs.push_back(192u);
+                continue;
+            }
+            for (uint32_t z = 0; z < 128; z++)
+            {
+                runs.push_back(((x + y + z) % 2 == 0 ? static_cast<uint32_t>(BlockType::stone_block) << 16u : 0u) | 1u);
+            }
+            runs.push_back(128u);
+        }
+    }
+
+    for (int32_t dx = -WORLD_RADIUS; dx <= WORLD_RADIUS; dx++)
+    {
+        for (int32_t dy = -WORLD_RADIUS; dy <= WORLD_RADIUS; dy++)
+        {
+            db.baked.emplace(ChunkID { dx * static_cast<int32_t>(CHUNK_WIDTH), dy * static_cast<int32_t>(CHUNK_WIDTH) }, runs);
+        }
+    }
+}
+
+#endif
@@ -16,9 +16,13 @@ void main() {
     uv = vec3(
         float((vertex_param & (1u << 27)) >> 27),
         float((vertex_param & (1u << 26)) >> 26),
-        float(vertex_param & ((1u << 26) - 1))
+        float(vertex_param & ((1u << 18) - 1))
     );
     vec3 vertex_n = normals[(vertex_param & (0x7u << 29)) >> 29];
-    light = clamp(dot(sun_dir, vertex_n), 0.6, 1.0);
+
+    // Each light level is 0.8 times as bright as the one above it, the sun only shades the faces lit by the sky.
+    float sky_light = pow(0.8, float(15u - ((vertex_param >> 18) & 0xfu)));
+    float block_light = pow(0.8, float(15u - ((vertex_param >> 22) & 0xfu)));
+    light = max(sky_light * clamp(dot(sun_dir, vertex_n), 0.6, 1.0), block_light);
     opaque = ((vertex_param & (0x1u << 28)) >> 28) & uint(length(gl_Position.xyz) < 160);
 }
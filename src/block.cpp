@@ -2,8 +2,8 @@
 
 #include <array>
 
-constexpr GLfloat                               _0 = 0.f, _1 = 1.f;
-constexpr array<array<array<GLfloat, 3>, 6>, 6> id_block_vertices = { {
+constexpr float                               _0 = 0.f, _1 = 1.f;
+constexpr array<array<array<float, 3>, 6>, 6> id_block_vertices = { {
     [FACE_LEFT]   = { {
         { { _0, _0, _1 } },
         { { _0, _1, _1 } },
@@ -59,7 +59,7 @@ constexpr array<array<array<GLfloat, 3>, 6>, 6> id_block_vertices = { {
         { { _0, _1, _1 } },
     } },
 } };
-constexpr array<array<GLfloat, 3>, 12>          tf_block_vertices = { {
+constexpr array<array<float, 3>, 12>          tf_block_vertices = { {
     { { _1, _0, _1 } },
     { { _0, _1, _1 } },
     { { _0, _1, _0 } },
@@ -86,19 +86,22 @@ constexpr array<uint8_t, 6> uv_coord = { {
     0b10,
 } };
 
-void BlockData::insert_face_vertices(vector<BlockVertex>& vertices, BlockID const& block_id, uint8_t f) const
+// A change to the vertices made here needs a bump of MESHER_VERSION in chunk.cpp.
+void BlockData::insert_face_vertices(BlockVertices& vertices, BlockID const& block_id, uint8_t f, uint8_t light) const
 {
-    if (has_six_faces())
+    uint32_t opaque = (BlockRegistry::flags(type()) & BLOCK_OPAQUE) != 0;
+    if ((BlockRegistry::flags(type()) & BLOCK_SIX_FACES) != 0)
     {
         for (int i = 0; i < 6; i++)
         {
-            vertices.emplace_back(BlockVertex(id_block_vertices[f][i][0] + static_cast<GLfloat>(block_id.x), //
-                                              id_block_vertices[f][i][1] + static_cast<GLfloat>(block_id.y), //
-                                              id_block_vertices[f][i][2] + static_cast<GLfloat>(block_id.z), //
-                                              f,                                                             //
-                                              block_config[type].is_opaque,                                  //
-                                              uv_coord[i],                                                   //
-                                              block_config[type].tex[f])                                     //
+            vertices.emplace_back(BlockVertex(id_block_vertices[f][i][0] + static_cast<float>(block_id.x), //
+                                              id_block_vertices[f][i][1] + static_cast<float>(block_id.y), //
+                                              id_block_vertices[f][i][2] + static_cast<float>(block_id.z), //
+                                              f,                                                           //
+                                              opaque,                                                      //
+                                              uv_coord[i],                                                 //
+                                              light,                                                       //
+                                              BlockRegistry::tex(type(), f))                               //
             );
         }
     }
@@ -108,13 +111,14 @@ void BlockData::insert_face_vertices(vector<BlockVertex>& vertices, BlockID cons
         {
             for (int i = 0; i < 6; i++)
             {
-                vertices.emplace_back(BlockVertex(tf_block_vertices[f * 6 + i][0] + static_cast<GLfloat>(block_id.x), //
-                                                  tf_block_vertices[f * 6 + i][1] + static_cast<GLfloat>(block_id.y), //
-                                                  tf_block_vertices[f * 6 + i][2] + static_cast<GLfloat>(block_id.z), //
-                                                  FACE_TOP,                                                           //
-                                                  block_config[type].is_opaque,                                       //
-                                                  uv_coord[i],                                                        //
-                                                  block_config[type].tex[0])                                          //
+                vertices.emplace_back(BlockVertex(tf_block_vertices[f * 6 + i][0] + static_cast<float>(block_id.x), //
+                                                  tf_block_vertices[f * 6 + i][1] + static_cast<float>(block_id.y), //
+                                                  tf_block_vertices[f * 6 + i][2] + static_cast<float>(block_id.z), //
+                                                  FACE_TOP,                                                         //
+                                                  opaque,                                                           //
+                                                  uv_coord[i],                                                      //
+                                                  light,                                                            //
+                                                  BlockRegistry::tex(type(), 0))                                    //
                 );
             }
         }
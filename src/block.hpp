@@ -3,27 +3,36 @@
 
 #include <vector>
 
+#include "block_registry.hpp"
 #include "config.hpp"
 #include "math.hpp"
-#include "opengl.hpp"
+#include "memory.hpp"
 
 using namespace std;
 
+// Cached on disk, see MESHER_VERSION in chunk.cpp before changing the layout or the packing of param.
 struct BlockVertex
 {
-    GLfloat x, y, z;
-    GLuint  param; // 3 bits: face index, 1 bit: opaque, 2 bits: uv_coord, 26 bits: tex index
+    float    x, y, z;
+    uint32_t param; // 3 bits: face index, 1 bit: opaque, 2 bits: uv_coord, 8 bits: light, 18 bits: tex index
 
-    BlockVertex(GLfloat x, GLfloat y, GLfloat z, uint32_t face, uint32_t opaque, uint32_t uv_coord, uint32_t tex) : x(x), y(y), z(z)
+    // Uninitialized, for meshes read back whole, see MeshCache::load().
+    BlockVertex() = default;
+
+    BlockVertex(float x, float y, float z, uint32_t face, uint32_t opaque, uint32_t uv_coord, uint32_t light, uint32_t tex) : x(x), y(y), z(z)
     {
         param = 0;
         param |= face << 29u;
         param |= opaque << 28u;
         param |= uv_coord << 26u;
+        param |= light << 18u;
         param |= tex;
     }
 };
 
+// Mesh vertices, counted in MemoryCategory::meshes.
+using BlockVertices = vector<BlockVertex, TrackedAllocator<BlockVertex, MemoryCategory::meshes>>;
+
 class BlockID
 {
 public:
@@ -43,33 +52,113 @@ public:
     }
 };
 
+// 10 bits of type and 6 bits of state, as marshalled. The state is the level of water, see WATER_FALLING. Packed by hand
+// in one word rather than in bit-fields, whose layout is up to the compiler and whose copies it splits field by field.
 class BlockData
 {
-public:
-    uint16_t type = 0;
+private:
+    // Type in the low 10 bits, level in the high 6.
+    uint16_t packed = 0;
 
 public:
+    constexpr BlockData() = default;
+
+    constexpr BlockData(uint16_t type, uint16_t level = 0) : packed(static_cast<uint16_t>((type & 0x3ffu) | (level & 0x3fu) << 10u))
+    {
+    }
+
+    [[nodiscard]] uint16_t type() const
+    {
+        return packed & 0x3ffu;
+    }
+
+    [[nodiscard]] uint16_t level() const
+    {
+        return packed >> 10u;
+    }
+
+    void set_type(uint16_t type)
+    {
+        packed = static_cast<uint16_t>((packed & ~0x3ffu) | (type & 0x3ffu));
+    }
+
+    void set_level(uint16_t level)
+    {
+        packed = static_cast<uint16_t>((packed & 0x3ffu) | (level & 0x3fu) << 10u);
+    }
+
+    // Both fields, as marshalled.
+    [[nodiscard]] uint16_t bits() const
+    {
+        return packed;
+    }
+
+    static BlockData from_bits(uint16_t bits)
+    {
+        return BlockData { static_cast<uint16_t>(bits & 0x3ffu), static_cast<uint16_t>(bits >> 10u) };
+    }
+
     void clear()
     {
-        type = 0;
+        packed = 0;
     }
 
     [[nodiscard]] bool is_null() const
     {
-        return type == 0;
+        return type() == 0;
+    }
+
+    bool operator==(BlockData const& o) const
+    {
+        return packed == o.packed;
+    }
+
+    bool operator!=(BlockData const& o) const
+    {
+        return !(*this == o);
+    }
+
+    [[nodiscard]] uint8_t flags() const
+    {
+        return BlockRegistry::flags(type());
     }
 
     [[nodiscard]] bool is_opaque() const
     {
-        return block_config[type].is_opaque;
+        return (flags() & BLOCK_OPAQUE) != 0;
     }
 
     [[nodiscard]] bool has_six_faces() const
     {
-        return block_config[type].has_six_faces;
+        return (flags() & BLOCK_SIX_FACES) != 0;
     }
 
-    void insert_face_vertices(vector<BlockVertex>& vertices, BlockID const& block_id, uint8_t f) const;
+    [[nodiscard]] bool is_ticking() const
+    {
+        return (flags() & BLOCK_TICKING) != 0;
+    }
+
+    [[nodiscard]] uint8_t emission() const
+    {
+        return (flags() & BLOCK_EMITTING) != 0 ? BlockRegistry::emission(type()) : 0;
+    }
+
+    // Opaque full blocks, the ones objects collide with. They are also the ones that stop light.
+    [[nodiscard]] bool is_solid() const
+    {
+        return (flags() & BLOCK_SOLID) != 0;
+    }
+
+    // Whether replacing this block with o changes how light spreads.
+    [[nodiscard]] bool changes_light(BlockData const& o) const
+    {
+        return is_solid() != o.is_solid() || emission() != o.emission();
+    }
+
+    // light is the packed light of the block the face looks into.
+    void insert_face_vertices(BlockVertices& vertices, BlockID const& block_id, uint8_t f, uint8_t light) const;
 };
 
+static_assert(sizeof(BlockData) == 2);
+
 #endif
@@ -1,61 +1,462 @@
 #include "block_manager.hpp"
 
-#include "db.hpp"
-#include "player.hpp"
+#include <algorithm>
 
-void BlockManager::init()
+#include "chunk_cursor.hpp"
+#include "job.hpp"
+#include "profile.hpp"
+
+void BlockManager::shutdown()
 {
-    for (auto const& p : DB::ins().chunks)
+    for (Chunk* chunk : chunks)
     {
-        ChunkID const& chunk_id = p.first;
-        chunks.emplace(chunk_id, new Chunk(chunk_id));
-        chunks_need_update.insert(chunk_id);
+        delete chunk;
     }
+    chunks.clear();
+    chunks_need_update.clear();
+    chunks_to_load.clear();
+    load_queued = false;
+    ticks.clear();
 }
 
-void BlockManager::shutdown()
+void BlockManager::update(vec3 const& center, vec3 const& forward, vec3 const& velocity, chrono::microseconds budget)
 {
-    for (auto& p : chunks)
+    using namespace std::chrono;
+    PROFILE_ZONE("BlockManager::update");
+
+    auto start = steady_clock::now();
+
+    stream_pos     = vec2(center);
+    stream_ahead   = ahead_of(center, velocity);
+    stream_forward = length(vec2(forward)) > 0.f ? normalize(vec2(forward)) : vec2(0.f);
+
+    ChunkID center_id { static_cast<int32_t>(center.x), static_cast<int32_t>(center.y) };
+    ChunkID ahead_id { static_cast<int32_t>(stream_ahead.x), static_cast<int32_t>(stream_ahead.y) };
+    if (unloading)
     {
-        delete p.second;
+        chunks.follow(center_id, range + UNLOAD_MARGIN + STREAM_AHEAD_MAX + 1);
+    }
+    if (!load_queued || !(center_id == load_center) || !(ahead_id == ahead_center))
+    {
+        queue_missing_chunks(center_id, ahead_id);
+    }
+
+    // The priorities follow the player between rescans of the window.
+    chunks_to_load.erase(remove_if(chunks_to_load.begin(), chunks_to_load.end(), [&](auto const& p) { return get_chunk(p.second) != nullptr; }),
+                         chunks_to_load.end());
+    for (auto& [priority, chunk_id] : chunks_to_load)
+    {
+        priority = stream_priority(chunk_id);
+    }
+    sort(chunks_to_load.begin(), chunks_to_load.end(), [](auto const& a, auto const& b) { return a.first > b.first; });
+
+    // A chunk is meshed once the neighbours it will have are loaded, loading one of them would mark it again. Chunks out of
+    // the mesh window keep the mesh they have, and their changes wait for them to come back into it.
+    auto is_ready = [&](ChunkID const& chunk_id) {
+        if (!in_mesh_window(chunk_id))
+            return false;
+        for (auto [dx, dy] : { pair { -1, 0 }, pair { 1, 0 }, pair { 0, -1 }, pair { 0, 1 } })
+        {
+            ChunkID other = chunk_id.add(dx, dy);
+            if (get_chunk(other) == nullptr && in_window(other))
+                return false;
+        }
+        return true;
+    };
+
+    // Chunks ready to mesh, a heap with the most urgent on top. An entry whose chunk is not in chunks_need_update any more
+    // was meshed since it was pushed.
+    vector<pair<float, ChunkID>> meshes {};
+    auto                         closer     = [](auto const& a, auto const& b) { return a.first > b.first; };
+    auto                         queue_mesh = [&](ChunkID const& chunk_id) {
+        if (meshing && chunks_need_update.count(chunk_id) != 0 && get_chunk(chunk_id) != nullptr && is_ready(chunk_id))
+        {
+            meshes.emplace_back(stream_priority(chunk_id), chunk_id);
+            push_heap(meshes.begin(), meshes.end(), closer);
+        }
+    };
+    for (auto it = chunks_need_update.begin(); it != chunks_need_update.end();)
+    {
+        // Neighbours that are not loaded have nothing to mesh, loading them marks them again.
+        if (get_chunk(*it) == nullptr)
+        {
+            it = chunks_need_update.erase(it);
+            continue;
+        }
+        queue_mesh(*it++);
+    }
+
+    // Loads and meshes interleave by priority, a batch at a time on all threads, until budget is spent. The rest is
+    // left for the next call.
+    uint32_t        batch_size = min(n_threads, JobSystem::ins().size());
+    vector<ChunkID> batch {};
+    while (duration_cast<microseconds>(steady_clock::now() - start) <= budget)
+    {
+        while (!chunks_to_load.empty() && get_chunk(chunks_to_load.back().second) != nullptr)
+        {
+            chunks_to_load.pop_back();
+        }
+        while (!meshes.empty() && chunks_need_update.count(meshes.front().second) == 0)
+        {
+            pop_heap(meshes.begin(), meshes.end(), closer);
+            meshes.pop_back();
+        }
+        if (chunks_to_load.empty() && meshes.empty())
+        {
+            break;
+        }
+
+        batch.clear();
+        if (!chunks_to_load.empty() && (meshes.empty() || chunks_to_load.back().first <= meshes.front().first))
+        {
+            while (batch.size() < batch_size && !chunks_to_load.empty())
+            {
+                if (get_chunk(chunks_to_load.back().second) == nullptr)
+                    batch.push_back(chunks_to_load.back().second);
+                chunks_to_load.pop_back();
+            }
+            load_chunks(batch);
+            for (ChunkID const& chunk_id : batch)
+            {
+                queue_mesh(chunk_id);
+                queue_mesh(chunk_id.add(-1, 0));
+                queue_mesh(chunk_id.add(1, 0));
+                queue_mesh(chunk_id.add(0, -1));
+                queue_mesh(chunk_id.add(0, 1));
+            }
+        }
+        else
+        {
+            while (batch.size() < batch_size && !meshes.empty())
+            {
+                ChunkID chunk_id = meshes.front().second;
+                pop_heap(meshes.begin(), meshes.end(), closer);
+                meshes.pop_back();
+                if (chunks_need_update.erase(chunk_id) != 0)
+                    batch.push_back(chunk_id);
+            }
+            mesh_chunks(batch);
+        }
+    }
+
+    if (!meshing)
+    {
+        chunks_need_update.clear();
     }
-    chunks.clear();
-    chunks_need_update.clear();
 }
 
-void BlockManager::update()
+void BlockManager::queue_missing_chunks(ChunkID const& center_id, ChunkID const& ahead_id)
 {
-    vec3              player_pos = Player::ins().pos;
-    ChunkID           chunk_id_0 { static_cast<int32_t>(player_pos.x), static_cast<int32_t>(player_pos.y) };
-    constexpr int32_t range = 10;
-    for (int32_t dx = -range; dx <= range; dx++)
+    // Chunks still queued from the last window and out of the new one are dropped.
+    load_center  = center_id;
+    ahead_center = ahead_id;
+    load_queued  = true;
+
+    chunks_to_load.clear();
+    if (!loading)
+    {
+        return;
+    }
+    if (unloading)
     {
-        for (int32_t dy = -range; dy <= range; dy++)
+        unload_chunks();
+    }
+
+    int32_t           r = load_range(range);
+    array<ChunkID, 2> windows { center_id, ahead_id };
+    for (size_t w = 0; w < windows.size(); w++)
+    {
+        for (int32_t dx = -r; dx <= r; dx++)
         {
-            ChunkID chunk_id = chunk_id_0.add(dx, dy);
-            if (get_chunk(chunk_id) == nullptr)
+            for (int32_t dy = -r; dy <= r; dy++)
             {
-                chunks.emplace(chunk_id, new Chunk(chunk_id));
-                set_chunks_need_update(chunk_id);
+                ChunkID chunk_id = windows[w].add(dx, dy);
+                if (get_chunk(chunk_id) == nullptr && (w == 0 || !in_window(chunk_id, center_id, r)))
+                {
+                    chunks_to_load.emplace_back(0.f, chunk_id);
+                }
             }
         }
     }
+}
+
+void BlockManager::unload_chunks()
+{
+    PROFILE_ZONE("BlockManager::unload_chunks");
 
-    if (!chunks_need_update.empty())
+    vector<ChunkID> far {};
+    for (Chunk const* chunk : chunks)
     {
-        for (auto const& chunk_id : chunks_need_update)
+        if (!in_window(chunk->chunk_id, load_center, range + UNLOAD_MARGIN) && !in_window(chunk->chunk_id, ahead_center, range + UNLOAD_MARGIN))
+            far.push_back(chunk->chunk_id);
+    }
+    for (ChunkID const& chunk_id : far)
+    {
+        remove_chunk(chunk_id);
+    }
+}
+
+vec2 BlockManager::ahead_of(vec3 const& center, vec3 const& velocity)
+{
+    // Loading runs ahead of a fast player by STREAM_AHEAD_MAX chunks at most.
+    vec2  ahead     = vec2(velocity) * STREAM_LOOKAHEAD_MS;
+    float max_ahead = static_cast<float>(STREAM_AHEAD_MAX * CHUNK_WIDTH);
+    if (length(ahead) > max_ahead)
+    {
+        ahead *= max_ahead / length(ahead);
+    }
+    return vec2(center) + ahead;
+}
+
+float BlockManager::stream_priority(ChunkID const& chunk_id) const
+{
+    vec2 p { static_cast<float>(static_cast<int32_t>(chunk_id.x)) + CHUNK_WIDTH / 2.f,
+             static_cast<float>(static_cast<int32_t>(chunk_id.y)) + CHUNK_WIDTH / 2.f };
+    vec2 d = p - stream_pos;
+
+    // 0 straight ahead of the camera, 1 straight behind it, and 0.5 everywhere without a direction.
+    float dist   = length(d);
+    float behind = dist > 0.f ? (1.f - dot(d, stream_forward) / dist) / 2.f : 0.f;
+    return min(dist, length(p - stream_ahead)) * (1.f + STREAM_BEHIND_WEIGHT * behind);
+}
+
+void BlockManager::load_chunks(vector<ChunkID> const& chunk_ids)
+{
+    PROFILE_ZONE("BlockManager::load_chunks");
+
+    // Generating and lighting a chunk only touches the chunk itself, the new chunks are built on all threads.
+    vector<Chunk*> loaded(chunk_ids.size());
+    JobSystem::ins().parallel_for(static_cast<uint32_t>(chunk_ids.size()), 1, n_threads, [&](uint32_t i) { loaded[i] = new Chunk(chunk_ids[i]); });
+
+    n_loaded += loaded.size();
+    for (Chunk* chunk : loaded)
+    {
+        chunks.put(chunk);
+        set_chunks_need_update(chunk->chunk_id);
+    }
+    for (Chunk* chunk : loaded)
+    {
+        light_seams(*chunk);
+    }
+    update_light();
+}
+
+void BlockManager::mesh_chunks(vector<ChunkID> const& chunk_ids)
+{
+    PROFILE_ZONE("BlockManager::mesh_chunks");
+
+    // Meshing a chunk only reads its neighbours, the chunks are meshed on all threads.
+    vector<pair<Chunk*, array<Chunk const*, 4>>> meshed {};
+    for (ChunkID const& chunk_id : chunk_ids)
+    {
+        meshed.emplace_back(get_chunk(chunk_id), ChunkCursor { *this, static_cast<int32_t>(chunk_id.x), static_cast<int32_t>(chunk_id.y), 0 }.adjacent());
+    }
+    n_meshed += meshed.size();
+    JobSystem::ins().parallel_for(static_cast<uint32_t>(meshed.size()), 1, n_threads, [&](uint32_t i) {
+        meshed[i].first->update(array<Chunk const*, 4> { meshed[i].second });
+    });
+}
+
+Chunk* BlockManager::load_chunk(ChunkID const& chunk_id)
+{
+    auto* chunk = new Chunk(chunk_id);
+    n_loaded++;
+    chunks.put(chunk);
+    light_seams(*chunk);
+    update_light();
+    return chunk;
+}
+
+void BlockManager::insert_chunk(Chunk* chunk)
+{
+    delete chunks.put(chunk);
+    set_chunks_need_update(chunk->chunk_id);
+    light_seams(*chunk);
+    update_light();
+}
+
+void BlockManager::remove_chunk(ChunkID const& chunk_id)
+{
+    Chunk* chunk = chunks.take(chunk_id);
+    if (chunk == nullptr)
+    {
+        return;
+    }
+    delete chunk;
+
+    // The faces of the neighbours on the border were hidden by the chunk.
+    set_chunks_need_update(chunk_id);
+    chunks_need_update.erase(chunk_id);
+}
+
+template<typename F>
+void BlockManager::for_each_chunk(BlockID const& min, BlockID const& max, F&& f, bool load)
+{
+    ChunkID chunk_id_0 { min }, chunk_id_1 { max };
+    for (uint32_t cx = chunk_id_0.x;; cx += CHUNK_WIDTH)
+    {
+        for (uint32_t cy = chunk_id_0.y;; cy += CHUNK_WIDTH)
         {
-            Chunk* chunk = get_chunk(chunk_id);
-            if (chunk != nullptr)
+            ChunkID chunk_id { static_cast<int32_t>(cx), static_cast<int32_t>(cy) };
+            Chunk*  chunk = get_chunk(chunk_id);
+            if (chunk == nullptr && load)
             {
-                chunk->update({ {
-                    get_chunk(chunk_id.add(-1, 0)),
-                    get_chunk(chunk_id.add(1, 0)),
-                    get_chunk(chunk_id.add(0, -1)),
-                    get_chunk(chunk_id.add(0, 1)),
-                } });
+                chunk = load_chunk(chunk_id);
             }
+
+            auto x0 = static_cast<uint16_t>(cx == chunk_id_0.x ? static_cast<uint64_t>(min.x) & BLOCK_INDEX_MASK : 0);
+            auto x1 = static_cast<uint16_t>(cx == chunk_id_1.x ? static_cast<uint64_t>(max.x) & BLOCK_INDEX_MASK : CHUNK_WIDTH - 1);
+            auto y0 = static_cast<uint16_t>(cy == chunk_id_0.y ? static_cast<uint64_t>(min.y) & BLOCK_INDEX_MASK : 0);
+            auto y1 = static_cast<uint16_t>(cy == chunk_id_1.y ? static_cast<uint64_t>(max.y) & BLOCK_INDEX_MASK : CHUNK_WIDTH - 1);
+            if (chunk != nullptr)
+                f(chunk, x0, x1, y0, y1);
+
+            if (cy == chunk_id_1.y)
+                break;
         }
-        chunks_need_update.clear();
+        if (cx == chunk_id_1.x)
+            break;
     }
 }
+
+template<typename F>
+void BlockManager::edit_region(BlockID const& min, BlockID const& max, F&& f)
+{
+    bool changed = false;
+    for_each_chunk(min, max, [&](Chunk* chunk, uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
+        // Calling into the light update from the loop would slow down every edit, the box is relit as a whole instead.
+        bool lit    = false;
+        auto edited = chunk->edit(x0, x1, y0, y1, min.z, max.z, [&](BlockData& block, BlockID const& block_id) {
+            BlockData old = block;
+            if (!f(block, block_id))
+                return false;
+            lit |= old.changes_light(block);
+            return true;
+        });
+        if (!edited)
+            return;
+        if (lit)
+            queue_light(*chunk, x0, x1, y0, y1, min.z, max.z);
+
+        changed = true;
+        set_chunks_need_update(chunk->chunk_id,
+                               (x0 == 0 ? FACE_LEFT_BIT : 0) | (x1 == CHUNK_WIDTH - 1 ? FACE_RIGHT_BIT : 0) |
+                                   (y0 == 0 ? FACE_FRONT_BIT : 0) | (y1 == CHUNK_WIDTH - 1 ? FACE_BACK_BIT : 0));
+    });
+
+    if (changed)
+    {
+        wake_water(min, max);
+        update_light();
+    }
+}
+
+void BlockManager::wake_water(BlockID const& min, BlockID const& max)
+{
+    if (!ticking)
+        return;
+
+    // Flowing water may have lost what fed it, and any water may now flow into air next to it.
+    BlockID lo { min.x - 1, min.y - 1, std::max(0, min.z - 1) };
+    BlockID hi { max.x + 1, max.y + 1, std::min(255, max.z + 1) };
+
+    ChunkCursor cursor { *this, lo };
+    for_each_chunk(
+        lo,
+        hi,
+        [&](Chunk const* chunk, uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
+            if (!chunk->may_tick(lo.z, hi.z))
+                return;
+
+            chunk->visit(x0, x1, y0, y1, lo.z, hi.z, [&](BlockData const& block, BlockID const& block_id) {
+                if (block.type() != BlockType::water_block)
+                    return;
+
+                if (block.level() == 0)
+                {
+                    cursor.move_to(block_id.x, block_id.y, block_id.z);
+                    if (cursor.get(-1, 0, 0) != nullptr && cursor.get(1, 0, 0) != nullptr && cursor.get(0, -1, 0) != nullptr &&
+                        cursor.get(0, 1, 0) != nullptr && (block_id.z == 0 || cursor.get(0, 0, -1) != nullptr))
+                        return;
+                }
+                ticks.schedule(block_id, WATER_TICK_DELAY);
+            });
+        },
+        false);
+}
+
+void BlockManager::fill(BlockID const& min, BlockID const& max, BlockData const& block)
+{
+    edit_region(min, max, [&](BlockData& b, BlockID const&) {
+        if (b == block)
+            return false;
+        b = block;
+        return true;
+    });
+}
+
+void BlockManager::replace(BlockID const& min, BlockID const& max, BlockData const& from, BlockData const& to)
+{
+    edit_region(min, max, [&](BlockData& b, BlockID const&) {
+        if (b != from)
+            return false;
+        b = to;
+        return true;
+    });
+}
+
+void BlockManager::carve_sphere(BlockID const& center, uint8_t radius)
+{
+    BlockID min { center.x - radius, center.y - radius, max(0, center.z - radius) };
+    BlockID max { center.x + radius, center.y + radius, std::min(255, center.z + radius) };
+
+    int32_t r2 = radius * radius;
+    edit_region(min, max, [&](BlockData& b, BlockID const& block_id) {
+        int32_t dx = block_id.x - center.x, dy = block_id.y - center.y, dz = block_id.z - center.z;
+        if (b.is_null() || dx * dx + dy * dy + dz * dz > r2)
+            return false;
+        b.clear();
+        return true;
+    });
+}
+
+BlockVolume BlockManager::copy(BlockID const& min, BlockID const& max)
+{
+    BlockVolume volume {};
+    volume.size_x = static_cast<uint32_t>(max.x - min.x) + 1;
+    volume.size_y = static_cast<uint32_t>(max.y - min.y) + 1;
+    volume.size_z = static_cast<uint32_t>(max.z - min.z) + 1;
+    volume.blocks.resize(volume.size_x * volume.size_y * volume.size_z);
+
+    for_each_chunk(
+        min,
+        max,
+        [&](Chunk const* chunk, uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
+            chunk->visit(x0, x1, y0, y1, min.z, max.z, [&](BlockData const& b, BlockID const& block_id) {
+                volume.at(block_id.x - min.x, block_id.y - min.y, block_id.z - min.z) = b;
+            });
+        },
+        false);
+
+    return volume;
+}
+
+void BlockManager::paste(BlockVolume const& volume, BlockID const& origin)
+{
+    if (volume.blocks.empty())
+        return;
+
+    // Whatever sticks out above the world is dropped.
+    BlockID max {
+        origin.x + static_cast<int32_t>(volume.size_x) - 1,
+        origin.y + static_cast<int32_t>(volume.size_y) - 1,
+        std::min<uint32_t>(255, origin.z + volume.size_z - 1),
+    };
+    edit_region(origin, max, [&](BlockData& b, BlockID const& block_id) {
+        auto const& block = volume.at(block_id.x - origin.x, block_id.y - origin.y, block_id.z - origin.z);
+        if (b == block)
+            return false;
+        b = block;
+        return true;
+    });
+}
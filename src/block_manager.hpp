@@ -1,39 +1,149 @@
 #ifndef BLOCK_MANAGER_HPP
 #define BLOCK_MANAGER_HPP
 
+#include <chrono>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "block.hpp"
+#include "block_tick.hpp"
 #include "chunk.hpp"
+#include "chunk_map.hpp"
 #include "util.hpp"
 
 using namespace std;
 
+// A box of blocks copied out of the world, in x, y, z order.
+class BlockVolume
+{
+public:
+    uint32_t size_x = 0, size_y = 0, size_z = 0;
+
+    vector<BlockData> blocks {};
+
+public:
+    BlockData& at(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return blocks[(x * size_y + y) * size_z + z];
+    }
+
+    BlockData const& at(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return blocks[(x * size_y + y) * size_z + z];
+    }
+};
+
 class BlockManager : private NonCopy<BlockManager>
 {
+public:
+    // update() keeps the chunks up to LOAD_RANGE chunks away from the center loaded, until set_range().
+    static constexpr int32_t LOAD_RANGE = 10;
+
 private:
-    unordered_map<ChunkID, Chunk*, ChunkID::Hasher> chunks {};
-    unordered_set<ChunkID, ChunkID::Hasher>         chunks_need_update {};
+    ChunkMap                                chunks {};
+    unordered_set<ChunkID, ChunkID::Hasher> chunks_need_update {};
 
-public:
-    void init();
+    // Missing chunks of the windows around load_center and around ahead_center, where the player is heading, valid while
+    // load_queued. Sorted by stream_priority(), the most urgent last.
+    vector<pair<float, ChunkID>> chunks_to_load {};
+    ChunkID                      load_center { 0, 0 }, ahead_center { 0, 0 };
+    bool                         load_queued = false;
+
+    // The player's position, where it will be in STREAM_LOOKAHEAD_MS and the horizontal direction the camera looks at.
+    vec2 stream_pos = vec2(0.f), stream_ahead = vec2(0.f), stream_forward = vec2(0.f);
+
+    BlockTicks ticks {};
+
+    // Chunks changed by block ticks or light updates and not marked for update yet, with FACE_*_BIT set for the borders
+    // that changed.
+    vector<pair<ChunkID, uint8_t>> dirty_chunks {};
 
+    // Light update queues for sky light [0] and block light [1], and the emitting blocks to light once they have run.
+    array<vector<LightNode>, 2> light_removes {}, light_adds {};
+    vector<LightNode>           light_sources {};
+
+    uint32_t n_threads = max(1u, thread::hardware_concurrency());
+
+    // What update() does, see set_loading(), set_meshing() and set_unloading(), and whether edits wake water, see
+    // set_ticking().
+    bool loading = true, meshing = true, unloading = true, ticking = true;
+
+    // Chunks up to load_range(range) away from the centers are loaded, and those up to range away meshed. Chunks more than
+    // range + UNLOAD_MARGIN away are unloaded.
+    int32_t range = LOAD_RANGE;
+
+    // Chunks created by loading and meshes built since the start, see get_n_loaded().
+    uint64_t n_loaded = 0, n_meshed = 0;
+
+public:
     void shutdown();
 
+    // A client gets its chunks from the server instead of loading them, see insert_chunk().
+    void set_loading(bool on)
+    {
+        loading = on;
+    }
+
+    // A server has no use for meshes, chunks are not marked for update.
+    void set_meshing(bool on)
+    {
+        meshing = on;
+    }
+
+    // A server loads the windows of all its clients, and unloads the chunks none of them is near itself. Chunks are not
+    // unloaded without loading, whoever inserts them removes them. Only the chunk grid of a manager that unloads follows its
+    // window, see ChunkMap.
+    void set_unloading(bool on)
+    {
+        unloading = on;
+    }
+
+    // A client's blocks are ticked by the server and come back in its deltas, edits schedule no ticks that tick() would
+    // never run.
+    void set_ticking(bool on)
+    {
+        ticking = on;
+    }
+
+    // Takes effect on the next update(), clamped to LOAD_RANGE_MIN .. LOAD_RANGE_MAX.
+    void set_range(int32_t r)
+    {
+        r = clamp(r, LOAD_RANGE_MIN, LOAD_RANGE_MAX);
+        if (r != range)
+        {
+            range       = r;
+            load_queued = false;
+        }
+    }
+
+    [[nodiscard]] int32_t get_range() const
+    {
+        return range;
+    }
+
+    // Adds a chunk built elsewhere, replacing the one with its id. Takes ownership of chunk.
+    void insert_chunk(Chunk* chunk);
+
+    void remove_chunk(ChunkID const& chunk_id);
+
     void add_block(BlockID const& block_id, BlockData&& block)
     {
         ChunkID chunk_id { block_id };
         Chunk*  chunk = get_chunk(chunk_id);
         if (chunk == nullptr)
         {
-            chunk = new Chunk(chunk_id);
-            chunks.emplace(chunk_id, chunk);
+            chunk = load_chunk(chunk_id);
         }
 
         set_chunks_need_update(chunk_id, block_id);
 
+        BlockData old = get_block_data(*chunk, block_id);
+        bool      lit = old.changes_light(block);
         chunk->add_block(block_id, forward<BlockData>(block));
+        wake_water(*chunk, block_id);
+        if (lit)
+            update_light(*chunk, block_id, old);
     }
 
     void del_block(BlockID const& block_id)
@@ -47,7 +157,11 @@ public:
 
         set_chunks_need_update(chunk_id, block_id);
 
+        BlockData old = get_block_data(*chunk, block_id);
         chunk->del_block(block_id);
+        wake_water(*chunk, block_id);
+        if (old.changes_light(BlockData {}))
+            update_light(*chunk, block_id, old);
     }
 
     BlockData const* get_block(BlockID const& block_id)
@@ -61,25 +175,139 @@ public:
         return chunk->get_block(block_id);
     }
 
-    void update();
-
-    void render() const
+    // One past the highest solid block at or below block_id.z in its column, 0 if there is none or the chunk is not loaded.
+    uint16_t ground_height(BlockID const& block_id)
     {
-        for (auto const& chunk : chunks)
+        Chunk* chunk = get_chunk(ChunkID { block_id });
+        if (chunk == nullptr)
         {
-            chunk.second->render();
+            return 0;
         }
+        return chunk->ground_height(block_id);
+    }
+
+    /*
+     * Region edits. Boxes are inclusive, with min <= max on every axis. They run chunk by chunk on the chunk's own storage
+     * and mark each changed chunk (and the neighbours sharing a changed border) for update once.
+     */
+    void fill(BlockID const& min, BlockID const& max, BlockData const& block);
+
+    void replace(BlockID const& min, BlockID const& max, BlockData const& from, BlockData const& to);
+
+    void carve_sphere(BlockID const& center, uint8_t radius);
+
+    // The blocks of the box, air in chunks that are not loaded.
+    [[nodiscard]] BlockVolume copy(BlockID const& min, BlockID const& max);
+
+    void paste(BlockVolume const& volume, BlockID const& origin);
+
+    /*
+     * Loads the missing chunks around center and meshes the chunks that need it, the most urgent first, until budget is
+     * spent. What is left carries over to the next call. Chunks in front of the camera looking along forward and where
+     * velocity (blocks per ms) is heading come first, see stream_priority().
+     */
+    void update(vec3 const& center, vec3 const& forward, vec3 const& velocity, chrono::microseconds budget = chrono::microseconds::max());
+
+    // Closest first.
+    void update(vec3 const& center, chrono::microseconds budget = chrono::microseconds::max())
+    {
+        update(center, vec3(0.f), vec3(0.f), budget);
+    }
+
+    // Where a player at center moving at velocity will be in STREAM_LOOKAHEAD_MS, update() also loads the window around it.
+    static vec2 ahead_of(vec3 const& center, vec3 const& velocity);
+
+    /*
+     * How far update() loads chunks for range: one ring further, so that every chunk up to range has all four neighbours
+     * when it is meshed. A chunk meshed before a neighbour arrives would be meshed again with it, and its border faces
+     * drawn in the meantime. The outer ring is loaded but not meshed.
+     */
+    static int32_t load_range(int32_t range)
+    {
+        return range + 1;
+    }
+
+    // Whether chunk_id is in the window of the chunks up to range away from center_id.
+    static bool in_window(ChunkID const& chunk_id, ChunkID const& center_id, int32_t range)
+    {
+        auto dx = static_cast<int32_t>(chunk_id.x - center_id.x) / static_cast<int32_t>(CHUNK_WIDTH);
+        auto dy = static_cast<int32_t>(chunk_id.y - center_id.y) / static_cast<int32_t>(CHUNK_WIDTH);
+        return abs(dx) <= range && abs(dy) <= range;
+    }
+
+    // Runs the block updates due by the next tick until budget is spent, returns how many ran.
+    size_t tick(chrono::microseconds budget);
+
+    [[nodiscard]] BlockTicks const& get_ticks() const
+    {
+        return ticks;
     }
 
-private:
     Chunk* get_chunk(ChunkID const& chunk_id)
     {
-        auto chunk = chunks.find(chunk_id);
-        if (chunk != chunks.end())
-        {
-            return chunk->second;
-        }
-        return nullptr;
+        return chunks.get(chunk_id);
+    }
+
+    ChunkMap const& get_chunks() const
+    {
+        return chunks;
+    }
+
+    // Together, the meshes built per chunk loaded while streaming.
+    [[nodiscard]] uint64_t get_n_loaded() const
+    {
+        return n_loaded;
+    }
+
+    [[nodiscard]] uint64_t get_n_meshed() const
+    {
+        return n_meshed;
+    }
+
+    // Chunks edited or loaded and not meshed yet, and their neighbours.
+    unordered_set<ChunkID, ChunkID::Hasher> const& get_chunks_need_update() const
+    {
+        return chunks_need_update;
+    }
+
+private:
+    // Creates a chunk that is not loaded yet, and carries light between it and its neighbours.
+    Chunk* load_chunk(ChunkID const& chunk_id);
+
+    // The same for a batch of chunks, built on all threads.
+    void load_chunks(vector<ChunkID> const& chunk_ids);
+
+    void mesh_chunks(vector<ChunkID> const& chunk_ids);
+
+    void queue_missing_chunks(ChunkID const& center_id, ChunkID const& ahead_id);
+
+    // Removes the chunks more than range + UNLOAD_MARGIN away from both windows. The margin keeps a player walking back and
+    // forth over a chunk border from loading and unloading the same chunks.
+    void unload_chunks();
+
+    // Whether update() loads chunk_id.
+    [[nodiscard]] bool in_window(ChunkID const& chunk_id) const
+    {
+        return in_window(chunk_id, load_center, load_range(range)) || in_window(chunk_id, ahead_center, load_range(range));
+    }
+
+    // Whether update() meshes chunk_id.
+    [[nodiscard]] bool in_mesh_window(ChunkID const& chunk_id) const
+    {
+        return in_window(chunk_id, load_center, range) || in_window(chunk_id, ahead_center, range);
+    }
+
+    /*
+     * How soon a chunk should be loaded and meshed, lower first: its distance in blocks from the player or from where the
+     * player will be, whichever is closer, counted up to 1 + STREAM_BEHIND_WEIGHT times as far the more it is behind the
+     * camera.
+     */
+    [[nodiscard]] float stream_priority(ChunkID const& chunk_id) const;
+
+    static BlockData get_block_data(Chunk& chunk, BlockID const& block_id)
+    {
+        BlockData const* block = chunk.get_block(block_id);
+        return block == nullptr ? BlockData {} : *block;
     }
 
     void set_chunks_need_update(ChunkID const& chunk_id)
@@ -91,6 +319,101 @@ private:
         chunks_need_update.insert(chunk_id.add(0, 1));
     }
 
+    // Marks a chunk for update, and the neighbours on the borders set in faces (FACE_*_BIT).
+    void set_chunks_need_update(ChunkID const& chunk_id, uint8_t faces)
+    {
+        chunks_need_update.insert(chunk_id);
+        if (faces & FACE_LEFT_BIT)
+            chunks_need_update.insert(chunk_id.add(-1, 0));
+        if (faces & FACE_RIGHT_BIT)
+            chunks_need_update.insert(chunk_id.add(1, 0));
+        if (faces & FACE_FRONT_BIT)
+            chunks_need_update.insert(chunk_id.add(0, -1));
+        if (faces & FACE_BACK_BIT)
+            chunks_need_update.insert(chunk_id.add(0, 1));
+    }
+
+    // Calls f(chunk, x0, x1, y0, y1) with the internal bounds of the box in every chunk it covers, creating missing chunks
+    // unless load is false.
+    template<typename F>
+    void for_each_chunk(BlockID const& min, BlockID const& max, F&& f, bool load = true);
+
+    // Calls Chunk::edit on the part of the box inside each chunk.
+    template<typename F>
+    void edit_region(BlockID const& min, BlockID const& max, F&& f);
+
+    // Schedules the water at and next to block_id after it changed. Most edits are away from water, which the chunk tells
+    // without looking at any block unless block_id is on its border.
+    void wake_water(Chunk const& chunk, BlockID const& block_id)
+    {
+        if (!ticking)
+            return;
+
+        uint64_t x  = static_cast<uint64_t>(block_id.x) & BLOCK_INDEX_MASK;
+        uint64_t y  = static_cast<uint64_t>(block_id.y) & BLOCK_INDEX_MASK;
+        auto     z0 = static_cast<uint8_t>(std::max(0, block_id.z - 1));
+        auto     z1 = static_cast<uint8_t>(std::min(255, block_id.z + 1));
+        if (x - 1 < CHUNK_WIDTH - 2 && y - 1 < CHUNK_WIDTH - 2 && !chunk.may_tick(z0, z1))
+            return;
+        wake_water(chunk, block_id, z0, z1);
+    }
+
+    void wake_water(Chunk const& chunk, BlockID const& block_id, uint8_t z0, uint8_t z1);
+
+    // Schedules the water in and around a changed box that may now flow or drain.
+    void wake_water(BlockID const& min, BlockID const& max);
+
+    void update_water(BlockID const& block_id);
+
+    // Writes a block during a tick, waking the water next to it.
+    void set_ticked_block(BlockID const& block_id, BlockData const& block);
+
+    // Relights the world after the block at block_id, which was old, changed how light spreads.
+    void update_light(Chunk& chunk, BlockID const& block_id, BlockData const& old)
+    {
+        queue_light(chunk, Chunk::to_index(block_id), old);
+        update_light();
+    }
+
+    // Queues the light updates for the block at i of chunk, which was old. update_light() runs them.
+    void queue_light(Chunk& chunk, uint16_t i, BlockData const& old);
+
+    // The same for a box of chunk's internal coordinates where any block may have changed.
+    void queue_light(Chunk& chunk, uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, uint8_t z0, uint8_t z1);
+
+    void update_light();
+
+    // Queues the light that crosses the borders between chunk and the loaded chunks next to it.
+    void light_seams(Chunk& chunk);
+
+    Chunk* light_outside(Chunk* chunk, int32_t dx, int32_t dy);
+
+    void mark_light(LightNode const& n)
+    {
+        mark_dirty(n.chunk->chunk_id, n.i >> 12u, (n.i >> 8u) & 0xfu);
+    }
+
+    // Remembers that the block at x, y of a chunk changed, see dirty_chunks.
+    void mark_dirty(ChunkID const& chunk_id, uint64_t x, uint64_t y)
+    {
+        uint8_t faces = (x == 0 ? FACE_LEFT_BIT : 0) | (x == CHUNK_WIDTH - 1 ? FACE_RIGHT_BIT : 0) | (y == 0 ? FACE_FRONT_BIT : 0) |
+                        (y == CHUNK_WIDTH - 1 ? FACE_BACK_BIT : 0);
+        if (!dirty_chunks.empty() && dirty_chunks.back().first == chunk_id)
+            dirty_chunks.back().second |= faces;
+        else
+            dirty_chunks.emplace_back(chunk_id, faces);
+    }
+
+    // Each chunk is marked once, however many of its blocks changed.
+    void flush_dirty_chunks()
+    {
+        for (auto const& [chunk_id, faces] : dirty_chunks)
+        {
+            set_chunks_need_update(chunk_id, faces);
+        }
+        dirty_chunks.clear();
+    }
+
     void set_chunks_need_update(ChunkID const& chunk_id, BlockID const& block_id)
     {
         chunks_need_update.insert(chunk_id);
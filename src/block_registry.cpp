@@ -0,0 +1,39 @@
+#include "block_registry.hpp"
+
+#include <exception>
+#include <iostream>
+
+uint16_t BlockRegistry::add(BlockConfig const& config)
+{
+    if (n_types == MAX_TYPES)
+    {
+        cerr << "Too many block types, at most " << MAX_TYPES << endl;
+        throw exception();
+    }
+
+    if (configs.empty())
+    {
+        configs.assign(block_config.begin(), block_config.end());
+    }
+    auto type = static_cast<uint16_t>(configs.size());
+    configs.push_back(config);
+    type_flags[type] = block_flags(config);
+
+    size_t n = configs.size();
+    size_t s = (n + 63) / 64;
+    table.assign(n * s, 0);
+    for (size_t a = 0; a < n; a++)
+    {
+        for (size_t b = 0; b < n; b++)
+        {
+            if (block_face_visible(type_flags[a], type_flags[b], a == b))
+                table[a * s + b / 64] |= uint64_t { 1 } << (b % 64);
+        }
+    }
+
+    type_configs = configs.data();
+    n_types      = n;
+    rows         = table.data();
+    stride       = s;
+    return type;
+}
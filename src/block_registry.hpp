@@ -0,0 +1,150 @@
+#ifndef BLOCK_REGISTRY_HPP
+#define BLOCK_REGISTRY_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "config.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+// Per type flags, see BlockRegistry::flags().
+enum BlockFlags : uint8_t
+{
+    BLOCK_OPAQUE    = 1u << 0u,
+    BLOCK_SIX_FACES = 1u << 1u,
+    BLOCK_SOLID     = 1u << 2u, // Opaque with six faces: objects collide with it, it stops light and hides faces against it.
+    BLOCK_TICKING   = 1u << 3u,
+    BLOCK_EMITTING  = 1u << 4u,
+};
+
+constexpr uint8_t block_flags(BlockConfig const& config)
+{
+    return static_cast<uint8_t>((config.is_opaque ? BLOCK_OPAQUE : 0) | (config.has_six_faces ? BLOCK_SIX_FACES : 0) |
+                                (config.is_opaque && config.has_six_faces ? BLOCK_SOLID : 0) | (config.is_ticking ? BLOCK_TICKING : 0) |
+                                (config.emission != 0 ? BLOCK_EMITTING : 0));
+}
+
+// Whether the face of a block with flags a against a block with flags b is drawn, same_type when both have the same type.
+constexpr bool block_face_visible(uint8_t a, uint8_t b, bool same_type)
+{
+    return (b & BLOCK_SOLID) == 0 && ((a & BLOCK_OPAQUE) != 0 || !same_type);
+}
+
+// The tables of block_config, see BlockRegistry.
+inline constexpr size_t BUILTIN_FACE_STRIDE = (block_config.size() + 63) / 64;
+
+inline constexpr array<uint64_t, block_config.size() * BUILTIN_FACE_STRIDE> BUILTIN_FACE_TABLE = [] {
+    array<uint64_t, block_config.size() * BUILTIN_FACE_STRIDE> table {};
+    for (size_t a = 0; a < block_config.size(); a++)
+        for (size_t b = 0; b < block_config.size(); b++)
+            if (block_face_visible(block_flags(block_config[a]), block_flags(block_config[b]), a == b))
+                table[a * BUILTIN_FACE_STRIDE + b / 64] |= uint64_t { 1 } << (b % 64);
+    return table;
+}();
+
+/*
+ * Properties of the block types, the ones of block_config and any added with add() at startup, before chunks are built.
+ * Meshing, collisions and light read them for nearly every block, so they are flattened into a byte of flags per type and
+ * a table of bits telling whether the face between two types is drawn. The reads are static and the tables of
+ * block_config are built at compile time, so that a read is a load from a fixed address, as block_config[type] was.
+ */
+class BlockRegistry : public Singleton<BlockRegistry>
+{
+public:
+    // BlockData::type() has 10 bits.
+    static constexpr size_t MAX_TYPES = 1u << 10u;
+
+private:
+    // Indexed by any 10 bit type, types not registered have no flags.
+    static inline array<uint8_t, MAX_TYPES> type_flags = [] {
+        array<uint8_t, MAX_TYPES> flags {};
+        for (size_t type = 0; type < block_config.size(); type++)
+            flags[type] = block_flags(block_config[type]);
+        return flags;
+    }();
+
+    // The types, and bit b of row a of stride words set when the face of a block of type a against a block of type b is
+    // drawn. They point at block_config and BUILTIN_FACE_TABLE until add() copies them into configs and table.
+    static inline BlockConfig const* type_configs = block_config.data();
+    static inline size_t             n_types      = block_config.size();
+    static inline uint64_t const*    rows         = BUILTIN_FACE_TABLE.data();
+    static inline size_t             stride       = BUILTIN_FACE_STRIDE;
+
+    vector<BlockConfig> configs {};
+    vector<uint64_t>    table {};
+
+public:
+    // The faces of one type against the others, see FaceTable::row().
+    struct FaceRow
+    {
+        uint64_t const* words;
+
+        // Whether the face shows against a block of type other: other does not hide it, and a transparent block does not
+        // show faces against its own type, like water against water.
+        [[nodiscard]] bool visible(uint16_t other) const
+        {
+            return (words[other >> 6u] >> (other & 63u) & 1u) != 0;
+        }
+    };
+
+    // The face table as of now, for loops to keep in registers across stores the compiler cannot tell apart from it.
+    struct FaceTable
+    {
+        uint64_t const* rows;
+        size_t          stride;
+
+        [[nodiscard]] FaceRow row(uint16_t type) const
+        {
+            return FaceRow { rows + type * stride };
+        }
+
+        [[nodiscard]] bool visible(uint16_t type, uint16_t other) const
+        {
+            return row(type).visible(other);
+        }
+    };
+
+public:
+    // Registers a new type and returns it. Throws past MAX_TYPES.
+    uint16_t add(BlockConfig const& config);
+
+    static size_t size()
+    {
+        return n_types;
+    }
+
+    static bool is_registered(uint16_t type)
+    {
+        return type < n_types;
+    }
+
+    static uint8_t flags(uint16_t type)
+    {
+        return type_flags[type];
+    }
+
+    static uint8_t emission(uint16_t type)
+    {
+        return type_configs[type].emission;
+    }
+
+    static uint32_t tex(uint16_t type, uint8_t f)
+    {
+        return type_configs[type].tex[f];
+    }
+
+    static FaceTable face_table()
+    {
+        return FaceTable { rows, stride };
+    }
+
+    static bool face_visible(uint16_t type, uint16_t other)
+    {
+        return face_table().visible(type, other);
+    }
+};
+
+#endif
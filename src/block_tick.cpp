@@ -0,0 +1,156 @@
+#include <algorithm>
+
+#include "block_manager.hpp"
+#include "chunk_cursor.hpp"
+#include "profile.hpp"
+
+static bool is_water(BlockData const* block)
+{
+    return block != nullptr && block->type() == BlockType::water_block;
+}
+
+// The level water passes on to the side, sources and falling water feed their neighbours like a source.
+static uint16_t spread_level(BlockData const& block)
+{
+    return block.level() == WATER_FALLING ? 0 : block.level();
+}
+
+size_t BlockManager::tick(chrono::microseconds budget)
+{
+    using namespace std::chrono;
+    PROFILE_ZONE("BlockManager::tick");
+
+    ticks.advance();
+
+    auto    start = steady_clock::now();
+    size_t  n     = 0;
+    BlockID block_id { 0, 0, 0 };
+    while (ticks.pop(block_id))
+    {
+        update_water(block_id);
+
+        // Reading the clock costs about as much as an update.
+        if (++n % 64 == 0 && duration_cast<microseconds>(steady_clock::now() - start) > budget)
+            break;
+    }
+
+    // Also marks the chunks changed during the tick for update.
+    update_light();
+
+    return n;
+}
+
+void BlockManager::wake_water(Chunk const& chunk, BlockID const& block_id, uint8_t z0, uint8_t z1)
+{
+    // On a border, the neighbouring chunk may be the only one with water.
+    auto may_tick = [&](ChunkID const& chunk_id) {
+        Chunk const* other = get_chunk(chunk_id);
+        return other != nullptr && other->may_tick(z0, z1);
+    };
+
+    uint64_t x = static_cast<uint64_t>(block_id.x) & BLOCK_INDEX_MASK;
+    uint64_t y = static_cast<uint64_t>(block_id.y) & BLOCK_INDEX_MASK;
+    if (!chunk.may_tick(z0, z1) && !(x == 0 && may_tick(chunk.chunk_id.add(-1, 0))) && !(x == CHUNK_WIDTH - 1 && may_tick(chunk.chunk_id.add(1, 0))) &&
+        !(y == 0 && may_tick(chunk.chunk_id.add(0, -1))) && !(y == CHUNK_WIDTH - 1 && may_tick(chunk.chunk_id.add(0, 1))))
+    {
+        return;
+    }
+
+    constexpr int32_t offsets[7][3] = { { 0, 0, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    ChunkCursor cursor { *this, block_id };
+    for (auto const& d : offsets)
+    {
+        if (is_water(cursor.get(d[0], d[1], d[2])))
+        {
+            ticks.schedule(BlockID { block_id.x + d[0], block_id.y + d[1], block_id.z + d[2] }, WATER_TICK_DELAY);
+        }
+    }
+}
+
+void BlockManager::set_ticked_block(BlockID const& block_id, BlockData const& block)
+{
+    ChunkID chunk_id { block_id };
+    Chunk*  chunk = get_chunk(chunk_id);
+    if (chunk == nullptr)
+    {
+        return;
+    }
+
+    // Levels are not meshed, only a change of type needs the chunk rebuilt.
+    BlockData old = get_block_data(*chunk, block_id);
+    if (old.type() != block.type())
+    {
+        mark_dirty(chunk_id, static_cast<uint64_t>(block_id.x) & BLOCK_INDEX_MASK, static_cast<uint64_t>(block_id.y) & BLOCK_INDEX_MASK);
+    }
+
+    if (block.is_null())
+        chunk->del_block(block_id);
+    else
+        chunk->add_block(block_id, BlockData { block });
+    wake_water(*chunk, block_id);
+    if (old.changes_light(block))
+        queue_light(*chunk, Chunk::to_index(block_id), old);
+}
+
+/*
+ * Water:
+ *  a source (level 0) stays, flowing water takes the level its neighbours give it and disappears past WATER_MAX_LEVEL.
+ *  Water falls into air below it, and only spreads to the side when it cannot fall.
+ */
+void BlockManager::update_water(BlockID const& block_id)
+{
+    ChunkCursor      cursor { *this, block_id };
+    BlockData const* current = cursor.get();
+    if (!is_water(current))
+    {
+        return;
+    }
+    BlockData block = *current;
+
+    constexpr int32_t sides[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+    if (block.level() != 0)
+    {
+        uint16_t level = WATER_FALLING;
+        if (block_id.z == 255 || !is_water(cursor.get(0, 0, 1)))
+        {
+            level = WATER_MAX_LEVEL + 1;
+            for (auto const& d : sides)
+            {
+                BlockData const* other = cursor.get(d[0], d[1], 0);
+                if (is_water(other) && (block_id.z == 0 || cursor.get(d[0], d[1], -1) != nullptr))
+                    level = min<uint16_t>(level, spread_level(*other) + 1);
+            }
+            if (level > WATER_MAX_LEVEL)
+            {
+                set_ticked_block(block_id, BlockData {});
+                return;
+            }
+        }
+        if (level != block.level())
+        {
+            block.set_level(level);
+            set_ticked_block(block_id, block);
+        }
+    }
+
+    if (block_id.z > 0 && cursor.get(0, 0, -1) == nullptr)
+    {
+        set_ticked_block(BlockID { block_id.x, block_id.y, block_id.z - 1 }, BlockData { BlockType::water_block, WATER_FALLING });
+        return;
+    }
+
+    uint16_t level = spread_level(block) + 1;
+    if (level > WATER_MAX_LEVEL)
+    {
+        return;
+    }
+    for (auto const& d : sides)
+    {
+        if (cursor.get(d[0], d[1], 0) == nullptr)
+        {
+            set_ticked_block(BlockID { block_id.x + d[0], block_id.y + d[1], block_id.z }, BlockData { BlockType::water_block, level });
+        }
+    }
+}
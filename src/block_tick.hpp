@@ -0,0 +1,86 @@
+#ifndef BLOCK_TICK_HPP
+#define BLOCK_TICK_HPP
+
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "block.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+// Block updates scheduled for a later tick, run in tick order and in the order they were scheduled within a tick. A
+// position is queued at most once, scheduling it again while it is pending does nothing.
+class BlockTicks : private NonCopy<BlockTicks>
+{
+private:
+    struct Scheduled
+    {
+        uint64_t tick, seq;
+        BlockID  block_id;
+
+        bool operator>(Scheduled const& o) const
+        {
+            return tick != o.tick ? tick > o.tick : seq > o.seq;
+        }
+    };
+
+    priority_queue<Scheduled, vector<Scheduled>, greater<>> queue {};
+    unordered_set<uint64_t>                                 pending {};
+
+    uint64_t now = 0, seq = 0;
+
+public:
+    void schedule(BlockID const& block_id, uint32_t delay)
+    {
+        if (pending.insert(key(block_id)).second)
+        {
+            queue.push(Scheduled { now + delay, seq++, block_id });
+        }
+    }
+
+    // Starts the next tick. Updates left over from earlier ticks stay due.
+    void advance()
+    {
+        now++;
+    }
+
+    // Takes the next update due by the current tick.
+    bool pop(BlockID& block_id)
+    {
+        if (queue.empty() || queue.top().tick > now)
+        {
+            return false;
+        }
+        block_id = queue.top().block_id;
+        queue.pop();
+        pending.erase(key(block_id));
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return queue.size();
+    }
+
+    [[nodiscard]] uint64_t get_tick() const
+    {
+        return now;
+    }
+
+    void clear()
+    {
+        queue   = {};
+        pending = {};
+    }
+
+private:
+    // 28 bits each of x and y are far beyond where floats can place the player.
+    static uint64_t key(BlockID const& block_id)
+    {
+        return (static_cast<uint64_t>(block_id.x) & 0xfff'ffffu) << 36u | (static_cast<uint64_t>(block_id.y) & 0xfff'ffffu) << 8u | block_id.z;
+    }
+};
+
+#endif
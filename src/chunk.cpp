@@ -1,53 +1,73 @@
 #include "chunk.hpp"
 
-#include "shader.hpp"
-#include "util.hpp"
+#include <cstring>
 
-ChunkVertices::ChunkVertices()
-{
-    vao = gen_vao();
-    vbo = gen_vbo();
-
-    // update vao
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BlockVertex), (GLvoid*) 0);
-    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(BlockVertex), (GLvoid*) (3 * sizeof(GLfloat)));
-    glBindVertexArray(0);
-}
+#include "mesh_cache.hpp"
+#include "profile.hpp"
 
-ChunkVertices::~ChunkVertices()
-{
-    del_vao(vao);
-    del_vbo(vbo);
-}
+// Part of mesh_key(). Bump it with any change to what update(), BlockData::insert_face_vertices() or BlockVertex make of
+// the same blocks, or meshes cached by older builds are taken for current ones.
+constexpr uint64_t MESHER_VERSION = 1;
 
-void ChunkVertices::upload_data(vector<BlockVertex> const& data)
+// 64 bit multiply-xor hash of words, fast enough to run on every block of a chunk. Not for input an adversary picks.
+class MeshHasher
 {
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(BlockVertex) * data.size(), data.data(), GL_STATIC_DRAW);
+private:
+    uint64_t h = 0x9e37'79b9'7f4a'7c15;
 
-    count = data.size();
-}
+public:
+    void add(uint64_t v)
+    {
+        h = (h ^ v) * 0xff51'afd7'ed55'8ccd;
+        h ^= h >> 32u;
+    }
 
-void ChunkVertices::render() const
-{
-    glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, count);
-    glBindVertexArray(0);
-}
+    void add(void const* data, size_t n)
+    {
+        auto const* bytes = static_cast<uint8_t const*>(data);
+        for (; n >= 8; n -= 8, bytes += 8)
+        {
+            uint64_t v;
+            memcpy(&v, bytes, 8);
+            add(v);
+        }
+        uint64_t tail = n;
+        memcpy(&tail, bytes, n);
+        add(tail ^ n << 56u);
+    }
+
+    [[nodiscard]] uint64_t get() const
+    {
+        return h ^ h >> 29u;
+    }
+};
 
 void Chunk::update(array<Chunk const*, 4>&& adj_chunks)
 {
-    vector<BlockVertex> vertices {};
+    PROFILE_ZONE("Chunk::update");
+
+    MeshCache& cache   = MeshCache::ins();
+    bool       caching = cache.is_enabled();
+    uint64_t   key     = 0;
+    if (caching)
+    {
+        key = mesh_key(adj_chunks);
+        if (cache.take(chunk_id, key, vertices))
+        {
+            vertices_updated = true;
+            return;
+        }
+    }
+
+    vertices.clear();
+
+    BlockRegistry::FaceTable const faces = BlockRegistry::face_table();
 
     for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
     {
         for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
         {
-            for (uint16_t z = 0; z < 256; z++)
+            for (uint16_t z = 0; z < height_any[x][y]; z++)
             {
                 auto& block = blocks[x][y][z];
                 if (block.is_null())
@@ -56,27 +76,129 @@ void Chunk::update(array<Chunk const*, 4>&& adj_chunks)
                 }
 
                 auto block_id = to_block_id(x, y, z);
-                if (block.has_six_faces())
+                if ((BlockRegistry::flags(block.type()) & BLOCK_SIX_FACES) != 0)
                 {
-                    auto adj_block = [&](uint8_t f, uint16_t _x, uint16_t _y) { return adj_chunks[f] == nullptr ? nullptr : &adj_chunks[f]->blocks[_x][_y][z]; };
-                    auto insert    = [&](uint8_t f, BlockData const* other) {
-                        if (other == nullptr || (!(other->is_opaque() && other->has_six_faces()) && (block.is_opaque() || block.type != other->type)))
-                            block.insert_face_vertices(vertices, block_id, f);
+                    BlockRegistry::FaceRow const row = faces.row(block.type());
+                    // A face is lit by the block it looks into, which is in owner, nullptr outside of the world and in
+                    // chunks not loaded.
+                    auto insert = [&](uint8_t f, Chunk const* owner, uint16_t _x, uint16_t _y, uint16_t _z) {
+                        if (owner == nullptr || row.visible(owner->blocks[_x][_y][_z].type()))
+                            block.insert_face_vertices(vertices, block_id, f, owner == nullptr ? LIGHT_MAX << SKY_LIGHT_SHIFT : owner->get_light(_x, _y, _z));
                     };
-                    insert(FACE_LEFT, x > 0 ? &blocks[x - 1][y][z] : adj_block(FACE_LEFT, CHUNK_WIDTH - 1, y));
-                    insert(FACE_RIGHT, x < CHUNK_WIDTH - 1 ? &blocks[x + 1][y][z] : adj_block(FACE_RIGHT, 0, y));
-                    insert(FACE_FRONT, y > 0 ? &blocks[x][y - 1][z] : adj_block(FACE_FRONT, x, CHUNK_WIDTH - 1));
-                    insert(FACE_BACK, y < CHUNK_WIDTH - 1 ? &blocks[x][y + 1][z] : adj_block(FACE_BACK, x, 0));
-                    insert(FACE_BOTTOM, z > 0 ? &blocks[x][y][z - 1] : nullptr);
-                    insert(FACE_TOP, z < 255 ? &blocks[x][y][z + 1] : nullptr);
+                    insert(FACE_LEFT, x > 0 ? this : adj_chunks[FACE_LEFT], x > 0 ? x - 1 : CHUNK_WIDTH - 1, y, z);
+                    insert(FACE_RIGHT, x < CHUNK_WIDTH - 1 ? this : adj_chunks[FACE_RIGHT], x < CHUNK_WIDTH - 1 ? x + 1 : 0, y, z);
+                    insert(FACE_FRONT, y > 0 ? this : adj_chunks[FACE_FRONT], x, y > 0 ? y - 1 : CHUNK_WIDTH - 1, z);
+                    insert(FACE_BACK, y < CHUNK_WIDTH - 1 ? this : adj_chunks[FACE_BACK], x, y < CHUNK_WIDTH - 1 ? y + 1 : 0, z);
+                    insert(FACE_BOTTOM, z > 0 ? this : nullptr, x, y, z > 0 ? z - 1 : 0);
+                    insert(FACE_TOP, z < 255 ? this : nullptr, x, y, z < 255 ? z + 1 : 0);
                 }
                 else
                 {
-                    block.insert_face_vertices(vertices, block_id, 0);
+                    block.insert_face_vertices(vertices, block_id, 0, get_light(x, y, static_cast<uint8_t>(z)));
                 }
             }
         }
     }
 
-    chunk_vertices.upload_data(vertices);
+    vertices_updated = true;
+
+    if (caching)
+    {
+        cache.store(chunk_id, key, vertices);
+    }
+}
+
+uint64_t Chunk::mesh_key(array<Chunk const*, 4> const& adj_chunks) const
+{
+    PROFILE_ZONE("Chunk::mesh_key");
+
+    MeshHasher hash;
+
+    // The mesher, and the types, their textures may change between builds.
+    hash.add(MESHER_VERSION);
+    hash.add(BlockRegistry::size());
+    for (uint16_t type = 0; type < BlockRegistry::size(); type++)
+    {
+        hash.add(BlockRegistry::flags(type));
+        for (uint8_t f = 0; f < 6; f++)
+            hash.add(BlockRegistry::tex(type, f));
+    }
+
+    // The chunk up to the top of each column, and its light up to one above the highest block.
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            hash.add(height_any[x][y]);
+            hash.add(blocks[x][y].data(), height_any[x][y] * sizeof(BlockData));
+        }
+    }
+    for (uint16_t s = 0; s <= min<uint16_t>(height_max >> 4u, 15); s++)
+    {
+        if (light[s] == nullptr)
+            hash.add(light_fill[s]);
+        else
+            hash.add(light[s]->data(), light[s]->size());
+    }
+
+    // The columns of the neighbours facing the chunk, up to its highest block.
+    array<uint8_t, 256> border_light {};
+    for (uint8_t f = 0; f < 4; f++)
+    {
+        Chunk const* adj = adj_chunks[f];
+        if (adj == nullptr)
+        {
+            hash.add(f);
+            continue;
+        }
+        for (uint16_t i = 0; i < CHUNK_WIDTH; i++)
+        {
+            uint16_t x = f == FACE_LEFT ? CHUNK_WIDTH - 1 : f == FACE_RIGHT ? 0 : i;
+            uint16_t y = f == FACE_FRONT ? CHUNK_WIDTH - 1 : f == FACE_BACK ? 0 : i;
+            hash.add(adj->blocks[x][y].data(), height_max * sizeof(BlockData));
+            for (uint16_t z = 0; z < height_max; z++)
+                border_light[z] = adj->get_light(x, y, static_cast<uint8_t>(z));
+            hash.add(border_light.data(), height_max);
+        }
+    }
+
+    return hash.get();
+}
+
+shared_ptr<ChunkSnapshot const> Chunk::snapshot()
+{
+    if (last_snapshot != nullptr && last_snapshot->version == version)
+    {
+        return last_snapshot;
+    }
+
+    auto snapshot      = make_shared<ChunkSnapshot>();
+    snapshot->chunk_id = chunk_id;
+    snapshot->version  = version;
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        if (last_snapshot != nullptr && (stale_sections & 1u << s) == 0)
+        {
+            snapshot->sections[s] = last_snapshot->sections[s];
+            continue;
+        }
+        if (section_blocks[s] == 0)
+        {
+            continue;
+        }
+
+        auto section = make_shared<BlockSection>();
+        for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+        {
+            for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+            {
+                copy_n(&blocks[x][y][s * 16], 16, &(*section)[x << 8u | y << 4u]);
+            }
+        }
+        snapshot->sections[s] = move(section);
+    }
+
+    stale_sections = 0;
+    last_snapshot  = snapshot;
+    return snapshot;
 }
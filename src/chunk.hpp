@@ -1,11 +1,14 @@
 #ifndef CHUNK_HPP
 #define CHUNK_HPP
 
+#include <algorithm>
 #include <array>
+#include <memory>
 #include <tuple>
 #include <vector>
 
 #include "block.hpp"
+#include "memory.hpp"
 #include "util.hpp"
 
 using namespace std;
@@ -59,21 +62,89 @@ public:
     }
 };
 
-class ChunkVertices : private NonCopy<ChunkVertices>
+// Bits of the 16 high sections covering z0 .. z1.
+inline uint16_t section_mask(uint32_t z0, uint32_t z1)
 {
-private:
-    GLuint vao;
-    GLuint vbo;
-    size_t count = 0;
+    return static_cast<uint16_t>((2u << (z1 >> 4u)) - (1u << (z0 >> 4u)));
+}
+
+using ChunkBlocks  = array<array<array<BlockData, 256>, CHUNK_WIDTH>, CHUNK_WIDTH>;
+using ChunkHeights = array<array<uint16_t, CHUNK_WIDTH>, CHUNK_WIDTH>;
+
+// Packed light of the blocks of a 16 high section, in x, y, z order like the blocks.
+using LightSection = Tracked<array<uint8_t, CHUNK_WIDTH * CHUNK_WIDTH * 16>, MemoryCategory::light>;
+
+// The blocks of a 16 high section, in x, y, z order like the light.
+using BlockSection = Tracked<array<BlockData, CHUNK_WIDTH * CHUNK_WIDTH * 16>, MemoryCategory::snapshots>;
+
+/*
+ * An immutable copy of a chunk's blocks as of one version, which any thread can read while the chunk is edited. Snapshots
+ * of the same chunk share the sections that were not edited in between.
+ */
+class ChunkSnapshot
+{
+public:
+    ChunkID  chunk_id;
+    uint64_t version = 0;
+
+    // nullptr for a section without blocks.
+    array<shared_ptr<BlockSection const>, 16> sections {};
 
 public:
-    ChunkVertices();
+    [[nodiscard]] BlockData at(uint16_t x, uint16_t y, uint8_t z) const
+    {
+        auto const& section = sections[z >> 4u];
+        return section == nullptr ? BlockData {} : (*section)[x << 8u | y << 4u | (z & 0xfu)];
+    }
+
+    [[nodiscard]] BlockData get_block(BlockID const& block_id) const
+    {
+        return at(static_cast<uint64_t>(block_id.x) & BLOCK_INDEX_MASK, static_cast<uint64_t>(block_id.y) & BLOCK_INDEX_MASK, block_id.z);
+    }
+};
 
-    ~ChunkVertices();
+// A block of a chunk as stored in the DB, 32 bits:
+//      x :  4,
+//      y :  4,
+//      z :  8,
+//     id : 10,
+//  level :  6,
+inline uint32_t marshal(uint16_t x, uint16_t y, uint16_t z, BlockData const& block)
+{
+    uint32_t v = 0;
+    v |= static_cast<uint32_t>(x) << 28u;
+    v |= static_cast<uint32_t>(y) << 24u;
+    v |= static_cast<uint32_t>(z) << 16u;
+    v |= static_cast<uint32_t>(block.type()) << 6u;
+    v |= static_cast<uint32_t>(block.level());
+    return v;
+}
+
+inline tuple<uint16_t, uint16_t, uint8_t, BlockData> unmarshal(uint32_t block)
+{
+    constexpr uint32_t X_MASK     = 0xf000'0000;
+    constexpr uint32_t Y_MASK     = 0x0f00'0000;
+    constexpr uint32_t Z_MASK     = 0x00ff'0000;
+    constexpr uint32_t TYPE_MASK  = 0x0000'ffc0;
+    constexpr uint32_t LEVEL_MASK = 0x0000'003f;
+
+    auto x     = static_cast<uint16_t>((block & X_MASK) >> 28u);
+    auto y     = static_cast<uint16_t>((block & Y_MASK) >> 24u);
+    auto z     = static_cast<uint8_t>((block & Z_MASK) >> 16u);
+    auto type  = static_cast<uint16_t>((block & TYPE_MASK) >> 6u);
+    auto level = static_cast<uint16_t>(block & LEVEL_MASK);
 
-    void upload_data(vector<BlockVertex> const& data);
+    return { x, y, z, BlockData { type, level } };
+}
 
-    void render() const;
+class Chunk;
+
+// A block in a light update, i is x << 12 | y << 8 | z in the chunk's internal coordinates.
+struct LightNode
+{
+    Chunk*   chunk;
+    uint16_t i;
+    uint8_t  level;
 };
 
 class Chunk : private NonCopy<Chunk>
@@ -82,25 +153,76 @@ public:
     const ChunkID chunk_id;
 
 private:
-    array<array<array<BlockData, 256>, CHUNK_WIDTH>, CHUNK_WIDTH> blocks {};
+    ChunkBlocks blocks {};
+
+    // One past the highest block, and one past the highest solid block, of each column. 0 for an empty column.
+    ChunkHeights height_any {}, height_solid {};
+    uint16_t     height_max = 0;
+
+    // Number of blocks in each 16 high section. Sections under height_max are counted on their first edit, until then
+    // they hold UNCOUNTED and are taken as not empty.
+    static constexpr uint16_t UNCOUNTED = 0xffff;
+    array<uint16_t, 16>       section_blocks {};
 
-    ChunkVertices chunk_vertices;
+    // Bit s is set once section s may hold ticking blocks. It is never cleared, so a clear bit is a guarantee.
+    uint16_t ticking_sections = 0;
+
+    // The same for blocks with an emission. Terrain has none, they only come from edits.
+    uint16_t emitting_sections = 0;
+
+    // Light of each section. A section without its array has light_fill for all of its blocks, it gets one on the first
+    // write of another value.
+    array<unique_ptr<LightSection>, 16> light {};
+    array<uint8_t, 16>                  light_fill {};
+
+    // Set once the blocks may differ from the generated terrain. Only modified chunks are written back to the DB.
+    bool modified = false;
+
+    // Built from a server's snapshot. The server stores the edits, a replica is never written to the DB.
+    bool replica = false;
+
+    // Bumped by every block change. last_snapshot is the one snapshot() handed out last, stale_sections the sections
+    // changed since.
+    uint64_t                        version        = 0;
+    shared_ptr<ChunkSnapshot const> last_snapshot  = nullptr;
+    uint16_t                        stale_sections = 0xffff;
+
+    // Mesh built by the last update(), until the renderer takes it.
+    BlockVertices vertices {};
+    bool          vertices_updated = false;
 
 public:
     explicit Chunk(ChunkID const& chunk_id);
 
+    // A copy of the blocks of snapshot, for a client replicating the chunks of a server.
+    explicit Chunk(ChunkSnapshot const& snapshot);
+
     ~Chunk();
 
+    // Converts a full list of marshalled blocks into the diff against the generated terrain.
+    static vector<uint32_t> diff_snapshot(ChunkID const& chunk_id, vector<uint32_t> const& snapshot);
+
+    // Generates the terrain of chunk_id, run-length encoded per column for DB::baked.
+    static vector<uint32_t> bake(ChunkID const& chunk_id);
+
     void add_block(BlockID const& block_id, BlockData&& block)
     {
-        auto [x, y, z]  = to_internal_coord(block_id);
+        auto [x, y, z] = to_internal_coord(block_id);
+        count_section(z);
+        count_block(z, blocks[x][y][z], block);
         blocks[x][y][z] = forward<BlockData>(block);
+        modified        = true;
+        update_height(x, y, z);
     }
 
     void del_block(BlockID const& block_id)
     {
         auto [x, y, z] = to_internal_coord(block_id);
+        count_section(z);
+        count_block(z, blocks[x][y][z], BlockData {});
         blocks[x][y][z].clear();
+        modified = true;
+        update_height(x, y, z);
     }
 
     BlockData const* get_block(BlockID const& block_id)
@@ -112,14 +234,250 @@ public:
         return &block;
     }
 
+    BlockData const& at(uint16_t x, uint16_t y, uint8_t z) const
+    {
+        return blocks[x][y][z];
+    }
+
+    // x << 12 | y << 8 | z of block_id inside its chunk, see LightNode.
+    static uint16_t to_index(BlockID const& block_id)
+    {
+        auto [x, y, z] = to_internal_coord(block_id);
+        return static_cast<uint16_t>(x << 12u | y << 8u | z);
+    }
+
+    BlockData const& at(uint16_t i) const
+    {
+        return blocks[i >> 12u][(i >> 8u) & 0xfu][i & 0xffu];
+    }
+
+    // Packed light of the block at i (see LightNode), SKY_LIGHT_SHIFT and BLOCK_LIGHT_SHIFT tell the two levels apart.
+    [[nodiscard]] uint8_t get_light(uint16_t i) const
+    {
+        auto const& section = light[(i & 0xffu) >> 4u];
+        return section == nullptr ? light_fill[(i & 0xffu) >> 4u] : (*section)[light_index(i)];
+    }
+
+    [[nodiscard]] uint8_t get_light(uint16_t x, uint16_t y, uint8_t z) const
+    {
+        return get_light(static_cast<uint16_t>(x << 12u | y << 8u | z));
+    }
+
+    // Whether all blocks of section s have the same light.
+    [[nodiscard]] bool is_light_uniform(uint8_t s) const
+    {
+        return light[s] == nullptr;
+    }
+
+    void set_light(uint16_t i, uint8_t value)
+    {
+        auto& section = light[(i & 0xffu) >> 4u];
+        if (section == nullptr)
+        {
+            uint8_t fill = light_fill[(i & 0xffu) >> 4u];
+            if (value == fill)
+                return;
+            section = make_unique<LightSection>();
+            section->fill(fill);
+        }
+        (*section)[light_index(i)] = value;
+    }
+
+    [[nodiscard]] uint64_t get_version() const
+    {
+        return version;
+    }
+
+    // The blocks as of now, for readers on other threads. Only the sections changed since the last snapshot are copied,
+    // the others are shared with it. Work started from a snapshot is stale once get_version() moved past its version.
+    shared_ptr<ChunkSnapshot const> snapshot();
+
+    // One past the highest block of the column, and of the whole chunk.
+    [[nodiscard]] uint16_t column_height(uint16_t x, uint16_t y) const
+    {
+        return height_any[x][y];
+    }
+
+    [[nodiscard]] uint16_t max_height() const
+    {
+        return height_max;
+    }
+
+    [[nodiscard]] bool is_section_empty(uint8_t z) const
+    {
+        return section_blocks[z >> 4u] == 0;
+    }
+
+    // Whether the sections covering z0 .. z1 may hold ticking blocks.
+    [[nodiscard]] bool may_tick(uint8_t z0, uint8_t z1) const
+    {
+        return (ticking_sections & section_mask(z0, z1)) != 0;
+    }
+
+    // One past the highest solid block at or below block_id.z in its column, 0 if there is none.
+    [[nodiscard]] uint16_t ground_height(BlockID const& block_id) const
+    {
+        auto [x, y, z] = to_internal_coord(block_id);
+        if (height_solid[x][y] <= z + 1)
+        {
+            return height_solid[x][y];
+        }
+
+        // Overhang, there is a solid block above z.
+        for (uint16_t h = z + 1; h > 0; h--)
+        {
+            if (blocks[x][y][h - 1].is_solid())
+                return h;
+        }
+        return 0;
+    }
+
+    // Calls f(block, block_id) for every block in the box [x0, x1] * [y0, y1] * [z0, z1] of internal coordinates. f returns
+    // whether it changed the block.
+    template<typename F>
+    bool edit(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, uint8_t z0, uint8_t z1, F&& f)
+    {
+        for (uint16_t z = z0 & ~15u; z <= z1; z += 16)
+        {
+            count_section(static_cast<uint8_t>(z));
+        }
+
+        bool changed = false;
+        for (uint16_t x = x0; x <= x1; x++)
+        {
+            for (uint16_t y = y0; y <= y1; y++)
+            {
+                for (uint16_t z = z0; z <= z1; z++)
+                {
+                    auto&     block = blocks[x][y][z];
+                    BlockData old   = block;
+                    if (f(block, to_block_id(x, y, z)))
+                    {
+                        count_block(z, old, block);
+                        changed = true;
+                    }
+                }
+            }
+        }
+        if (changed)
+        {
+            for (uint16_t x = x0; x <= x1; x++)
+                for (uint16_t y = y0; y <= y1; y++)
+                    update_height(x, y, z1);
+        }
+        modified |= changed;
+        return changed;
+    }
+
+    template<typename F>
+    void visit(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, uint8_t z0, uint8_t z1, F&& f) const
+    {
+        for (uint16_t x = x0; x <= x1; x++)
+        {
+            for (uint16_t y = y0; y <= y1; y++)
+            {
+                for (uint16_t z = z0; z <= z1; z++)
+                {
+                    f(blocks[x][y][z], to_block_id(x, y, z));
+                }
+            }
+        }
+    }
+
     void update(array<Chunk const*, 4>&& adj_chunks);
 
-    void render() const
+    // Hash of everything update() reads: the blocks and light of the chunk, the border columns of adj_chunks, the block
+    // types and the version of the mesher. Equal keys give the same mesh, see MeshCache.
+    [[nodiscard]] uint64_t mesh_key(array<Chunk const*, 4> const& adj_chunks) const;
+
+    // Moves the mesh built since the last call into out. Returns false if there is none.
+    bool take_vertices(BlockVertices& out)
     {
-        chunk_vertices.render();
+        if (!vertices_updated)
+            return false;
+        out              = move(vertices);
+        vertices         = {};
+        vertices_updated = false;
+        return true;
     }
 
 private:
+    // Recomputes the heights of a column from top down.
+    void scan_heights(uint16_t x, uint16_t y, uint16_t top)
+    {
+        auto const& column = blocks[x][y];
+
+        uint16_t z = top;
+        while (z > 0 && column[z - 1].is_null())
+            z--;
+
+        uint16_t old     = height_any[x][y];
+        height_any[x][y] = z;
+        if (z > height_max)
+        {
+            height_max = z;
+        }
+        else if (old == height_max && z < old)
+        {
+            height_max = 0;
+            for (auto const& row : height_any)
+                for (uint16_t h : row)
+                    height_max = max(height_max, h);
+        }
+
+        while (z > 0 && !column[z - 1].is_solid())
+            z--;
+        height_solid[x][y] = z;
+    }
+
+    // Keeps the heights of a column current after blocks at or below z changed. Changes under the highest solid block
+    // cannot move either height.
+    void update_height(uint16_t x, uint16_t y, uint16_t z)
+    {
+        if (z + 1 >= height_solid[x][y])
+        {
+            scan_heights(x, y, max<uint16_t>(height_any[x][y], z + 1));
+        }
+    }
+
+    void count_section(uint8_t z)
+    {
+        auto& n = section_blocks[z >> 4u];
+        if (n != UNCOUNTED)
+        {
+            return;
+        }
+
+        n = 0;
+        for (auto const& row : blocks)
+            for (auto const& column : row)
+                for (uint16_t i = z & ~15u; i < (z & ~15u) + 16; i++)
+                    n += column[i].type() != 0;
+    }
+
+    void count_block(uint8_t z, BlockData const& old, BlockData const& block)
+    {
+        section_blocks[z >> 4u] += static_cast<uint16_t>(!block.is_null()) - static_cast<uint16_t>(!old.is_null());
+        stale_sections |= section_mask(z, z);
+        version++;
+        if (block.is_ticking())
+            ticking_sections |= section_mask(z, z);
+        if (block.emission() != 0)
+            emitting_sections |= section_mask(z, z);
+    }
+
+    // Sets up the heights, the section counts and the light once the blocks are in, none being above tops.
+    void init(ChunkHeights const& tops);
+
+    // Lights the chunk as if it had no neighbours: sky light down every column and spread sideways into overhangs, and the
+    // light of its emitting blocks. BlockManager carries light across chunk borders.
+    void init_light();
+
+    static uint16_t light_index(uint16_t i)
+    {
+        return static_cast<uint16_t>((i >> 8u) << 4u | (i & 0xfu));
+    }
+
     static tuple<uint16_t, uint16_t, uint8_t> to_internal_coord(BlockID const& block_id)
     {
         return {
@@ -129,7 +487,7 @@ private:
         };
     }
 
-    BlockID to_block_id(uint16_t x, uint16_t y, uint8_t z)
+    BlockID to_block_id(uint16_t x, uint16_t y, uint8_t z) const
     {
         return {
             static_cast<int32_t>(chunk_id.x | x),
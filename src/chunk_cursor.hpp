@@ -0,0 +1,188 @@
+#ifndef CHUNK_CURSOR_HPP
+#define CHUNK_CURSOR_HPP
+
+#include <array>
+#include <cstdlib>
+
+#include "block_manager.hpp"
+#include "chunk.hpp"
+
+using namespace std;
+
+/*
+ * Walks the world block by block. The 3 * 3 chunks around the cursor are looked up once and kept while it moves, so
+ * reads near the cursor and steps into the next chunk need no hash lookup.
+ */
+class ChunkCursor
+{
+private:
+    BlockManager& block_manager;
+
+    int32_t      x, y, z;
+    ChunkID      chunk_id;
+    Chunk const* chunk;
+
+    // near[(dx + 1) * 3 + dy + 1] is the chunk at chunk_id.add(dx, dy), valid once its bit in resolved is set.
+    array<Chunk const*, 9> near {};
+    uint16_t               resolved = 0;
+
+public:
+    ChunkCursor(BlockManager& block_manager, int32_t x, int32_t y, int32_t z) : block_manager(block_manager), x(x), y(y), z(z), chunk_id(x, y)
+    {
+        chunk = block_manager.get_chunk(chunk_id);
+    }
+
+    ChunkCursor(BlockManager& block_manager, BlockID const& block_id) : ChunkCursor(block_manager, block_id.x, block_id.y, block_id.z)
+    {
+    }
+
+    [[nodiscard]] BlockID get_block_id() const
+    {
+        return { x, y, z };
+    }
+
+    // The chunk under the cursor, nullptr if it is not loaded.
+    [[nodiscard]] Chunk const* get_chunk() const
+    {
+        return chunk;
+    }
+
+    // The block at the cursor moved by (dx, dy, dz), nullptr for air, unloaded chunks and z outside of 0 .. 255.
+    BlockData const* get(int32_t dx = 0, int32_t dy = 0, int32_t dz = 0)
+    {
+        int32_t bz = z + dz;
+        if (bz < 0 || bz > 255)
+        {
+            return nullptr;
+        }
+
+        int32_t      bx = x + dx, by = y + dy;
+        Chunk const* c  = get_chunk(bx, by);
+        if (c == nullptr)
+        {
+            return nullptr;
+        }
+
+        auto const& block = c->at(static_cast<uint32_t>(bx) & BLOCK_INDEX_MASK, static_cast<uint32_t>(by) & BLOCK_INDEX_MASK, bz);
+        return block.is_null() ? nullptr : &block;
+    }
+
+    // Chunk::ground_height of the column at the cursor moved by (dx, dy), 0 if it is not loaded.
+    uint16_t ground_height(int32_t dx, int32_t dy)
+    {
+        if (z < 0)
+        {
+            return 0;
+        }
+
+        Chunk const* c = get_chunk(x + dx, y + dy);
+        return c == nullptr ? 0 : c->ground_height(BlockID { x + dx, y + dy, min(z, 255) });
+    }
+
+    // Moves by d blocks along axis 0 (x), 1 (y) or 2 (z).
+    void step(int axis, int32_t d)
+    {
+        switch (axis)
+        {
+            case 0: x += d; break;
+            case 1: y += d; break;
+            default: z += d; return;
+        }
+
+        ChunkID next { x, y };
+        if (!(next == chunk_id))
+        {
+            recenter(next);
+        }
+    }
+
+    void move_to(int32_t _x, int32_t _y, int32_t _z)
+    {
+        x = _x;
+        y = _y;
+        z = _z;
+
+        ChunkID next { x, y };
+        if (!(next == chunk_id))
+        {
+            recenter(next);
+        }
+    }
+
+    // The chunks next to the cursor's chunk in FACE_LEFT, FACE_RIGHT, FACE_FRONT, FACE_BACK order.
+    array<Chunk const*, 4> adjacent()
+    {
+        return { {
+            get_near(-1, 0),
+            get_near(1, 0),
+            get_near(0, -1),
+            get_near(0, 1),
+        } };
+    }
+
+private:
+    Chunk const* get_near(int32_t dx, int32_t dy)
+    {
+        if (dx == 0 && dy == 0)
+        {
+            return chunk;
+        }
+
+        int32_t i = (dx + 1) * 3 + dy + 1;
+        if ((resolved & (1u << i)) == 0)
+        {
+            near[i] = block_manager.get_chunk(chunk_id.add(dx, dy));
+            resolved |= 1u << i;
+        }
+        return near[i];
+    }
+
+    Chunk const* get_chunk(int32_t bx, int32_t by)
+    {
+        // Most reads stay in the cursor's own chunk.
+        if (((static_cast<uint32_t>(bx) ^ chunk_id.x) | (static_cast<uint32_t>(by) ^ chunk_id.y)) < CHUNK_WIDTH)
+        {
+            return chunk;
+        }
+
+        ChunkID target { bx, by };
+        auto    dx = static_cast<int32_t>(target.x - chunk_id.x) / static_cast<int32_t>(CHUNK_WIDTH);
+        auto    dy = static_cast<int32_t>(target.y - chunk_id.y) / static_cast<int32_t>(CHUNK_WIDTH);
+        if (abs(dx) > 1 || abs(dy) > 1)
+        {
+            return block_manager.get_chunk(target);
+        }
+        return get_near(dx, dy);
+    }
+
+    // Keeps the cached chunks that are still within reach of the new chunk.
+    void recenter(ChunkID const& next)
+    {
+        auto dx = static_cast<int32_t>(next.x - chunk_id.x) / static_cast<int32_t>(CHUNK_WIDTH);
+        auto dy = static_cast<int32_t>(next.y - chunk_id.y) / static_cast<int32_t>(CHUNK_WIDTH);
+
+        Chunk const* next_chunk = abs(dx) > 1 || abs(dy) > 1 ? block_manager.get_chunk(next) : get_near(dx, dy);
+
+        array<Chunk const*, 9> old_near     = near;
+        uint16_t               old_resolved = resolved | 1u << 4u;
+        old_near[4]                         = chunk;
+
+        resolved = 0;
+        for (int32_t i = 0; i < 3; i++)
+        {
+            for (int32_t j = 0; j < 3; j++)
+            {
+                int32_t oi = i + dx, oj = j + dy;
+                if (oi >= 0 && oi < 3 && oj >= 0 && oj < 3 && (old_resolved & (1u << (oi * 3 + oj))) != 0)
+                {
+                    near[i * 3 + j] = old_near[oi * 3 + oj];
+                    resolved |= 1u << (i * 3 + j);
+                }
+            }
+        }
+        chunk_id = next;
+        chunk    = next_chunk;
+    }
+};
+
+#endif
@@ -1,107 +1,198 @@
+#include <iostream>
+#include <memory>
 #include <random>
 #include <unordered_map>
 
 #include "chunk.hpp"
 #include "config.hpp"
 #include "db.hpp"
+#include "mesh_cache.hpp"
 #include "perlin.hpp"
+#include "profile.hpp"
 
 using namespace std;
 
-// 32 bits:
-//    x :  4,
-//    y :  4,
-//    z :  8,
-//   id : 10,
-//      :  6, (currently unused)
-static uint32_t marshal(uint16_t x, uint16_t y, uint16_t z, BlockData const& block)
+// noise_grid() is within NOISE_GRID_TOLERANCE of noise(). Where that is close enough to a rounding boundary of n * scale
+// to matter, the scalar value is used instead, so the terrain is identical to a double precision evaluation.
+static double exact_noise(float n, double scale, double offset, int32_t x, int32_t y, double period)
 {
-    uint32_t v = 0;
-    v |= static_cast<uint32_t>(x) << 28u;
-    v |= static_cast<uint32_t>(y) << 24u;
-    v |= static_cast<uint32_t>(z) << 16u;
-    v |= static_cast<uint32_t>(block.type) << 6u;
-    return v;
+    double t = n * scale + offset;
+    if (abs(t - floor(t) - 0.5) > 2.0 * PerlinNoise::NOISE_GRID_TOLERANCE * scale)
+    {
+        return n;
+    }
+    return PerlinNoise::noise(x / period, y / period, 0.0);
 }
 
-static tuple<BlockID, BlockData> unmarshal(ChunkID const& chunk_id, uint32_t block)
+// What generating a chunk tells about its blocks without another pass over them.
+struct Outline
+{
+    ChunkHeights tops;                 // A bound on the height of each column, nothing is above it.
+    uint16_t     ticking_sections = 0; // The sections that may hold ticking blocks.
+};
+
+// Terrain is a pure function of the chunk id and the seed, so chunks without player edits never need to be stored.
+static void generate_terrain(ChunkID const& chunk_id, ChunkBlocks& blocks, Outline& outline)
 {
-    constexpr uint32_t X_MASK    = 0xf000'0000;
-    constexpr uint32_t Y_MASK    = 0x0f00'0000;
-    constexpr uint32_t Z_MASK    = 0x00ff'0000;
-    constexpr uint32_t TYPE_MASK = 0x0000'ffc0;
+    uint32_t seed = DB::ins().seed;
 
-    auto x    = static_cast<int32_t>(((block & X_MASK) >> 28u) | chunk_id.x);
-    auto y    = static_cast<int32_t>(((block & Y_MASK) >> 24u) | chunk_id.y);
-    auto z    = static_cast<uint8_t>((block & Z_MASK) >> 16u);
-    auto type = static_cast<uint16_t>((block & TYPE_MASK) >> 6u);
+    mt19937                           rng { chunk_id.x + chunk_id.y + seed * 0x9e37'79b9u };
+    uniform_int_distribution<uint8_t> dist { 1, 100 };
 
-    return { BlockID { x, y, z }, BlockData { type } };
+    // The seed shifts the noise field, seed 0 is the original world.
+    auto noise_x = static_cast<int32_t>(chunk_id.x + seed * 0x9e37'79b1u);
+    auto noise_y = static_cast<int32_t>(chunk_id.y + seed * 0x85eb'ca77u);
+
+    array<float, CHUNK_WIDTH * CHUNK_WIDTH> height_noise, stone_noise;
+    PerlinNoise::noise_grid(noise_x, noise_y, CHUNK_WIDTH, CHUNK_WIDTH, 96, height_noise.data());
+    PerlinNoise::noise_grid(noise_x, noise_y, CHUNK_WIDTH, CHUNK_WIDTH, 3, stone_noise.data());
+
+    for (uint32_t _x = 0; _x < CHUNK_WIDTH; _x++)
+    {
+        auto x = static_cast<int32_t>(static_cast<uint32_t>(noise_x) + _x);
+        for (uint32_t _y = 0; _y < CHUNK_WIDTH; _y++)
+        {
+            auto  y      = static_cast<int32_t>(static_cast<uint32_t>(noise_y) + _y);
+            auto& column = blocks[_x][_y];
+
+            double n_h       = exact_noise(height_noise[_x * CHUNK_WIDTH + _y], 24.0, 0.0, x, y, 96.0);
+            double n_h_stone = exact_noise(stone_noise[_x * CHUNK_WIDTH + _y], 4.0, 4.0, x, y, 3.0);
+
+            auto    h       = static_cast<uint8_t>(round(n_h * 24.0) + 32);
+            uint8_t h_stone = h - static_cast<uint8_t>(round((n_h_stone + 1.0) / 2.0 * 8.0) + 4);
+
+            uint8_t z = 0;
+            for (; z < h_stone; z++)
+            {
+                column[z] = BlockData { BlockType::stone_block };
+            }
+            for (; z < h; z++)
+            {
+                column[z] = BlockData { BlockType::dirt_block };
+            }
+
+            if (z < 24)
+            {
+                for (; z < 24; z++)
+                {
+                    column[z] = BlockData { BlockType::water_block };
+                }
+                outline.tops[_x][_y] = z;
+                outline.ticking_sections |= section_mask(h, z - 1);
+            }
+            else
+            {
+                column[z] = BlockData { BlockType::grass_block };
+                auto p    = dist(rng);
+                if (p == 1)
+                {
+                    column[z + 1] = BlockData { BlockType::flower };
+                }
+                else if (p <= 10)
+                {
+                    column[z + 1] = BlockData { BlockType::grass };
+                }
+                outline.tops[_x][_y] = z + 2;
+            }
+        }
+    }
 }
 
-Chunk::Chunk(ChunkID const& chunk_id) : chunk_id(chunk_id)
+// Baked chunks: runs of (type << 16 | length) for each column in x, y order, each column's runs covering z = 0 .. 255.
+static vector<uint32_t> encode_runs(ChunkBlocks const& blocks)
 {
-    auto it = DB::ins().chunks.find(chunk_id);
-    if (it != DB::ins().chunks.end())
+    vector<uint32_t> runs {};
+
+    for (auto const& row : blocks)
     {
-        for (uint32_t const& b : it->second)
+        for (auto const& column : row)
         {
-            auto [block_id, block] = unmarshal(chunk_id, b);
-            add_block(block_id, forward<BlockData>(block));
+            uint32_t z0 = 0;
+            for (uint32_t z = 1; z <= 256; z++)
+            {
+                if (z == 256 || column[z] != column[z0])
+                {
+                    runs.push_back(static_cast<uint32_t>(column[z0].type()) << 16u | (z - z0));
+                    z0 = z;
+                }
+            }
         }
     }
-    else
-    {
-        mt19937                           rng { chunk_id.x + chunk_id.y };
-        uniform_int_distribution<uint8_t> dist { 1, 100 };
 
-        for (uint32_t _x = 0; _x < CHUNK_WIDTH; _x++)
+    return runs;
+}
+
+// Returns false if runs do not cover each column exactly, blocks are then partly filled.
+static bool decode_runs(vector<uint32_t> const& runs, ChunkBlocks& blocks, Outline& outline)
+{
+    uint32_t i = 0;
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
         {
-            auto x = static_cast<int32_t>(_x | chunk_id.x);
-            for (uint32_t _y = 0; _y < CHUNK_WIDTH; _y++)
+            auto& column = blocks[x][y];
+            outline.tops[x][y] = 0;
+            for (uint32_t z = 0; z < 256; i++)
             {
-                auto y = static_cast<int32_t>(_y | chunk_id.y);
-
-                auto    h       = static_cast<uint8_t>(round(PerlinNoise::noise(x / 96.0, y / 96.0, 0.0) * 24.0) + 32);
-                uint8_t h_stone = h - static_cast<uint8_t>(round((PerlinNoise::noise(x / 3.0, y / 3.0, 0.0) + 1.0) / 2.0 * 8.0) + 4);
+                if (i >= runs.size())
+                {
+                    return false;
+                }
 
-                uint8_t z = 0;
-                for (; z < h_stone; z++)
+                // The run is tested through its type, calls on block would keep it in memory and the fill from vectorizing.
+                auto      type   = static_cast<uint16_t>(runs[i] >> 16u);
+                uint32_t  length = runs[i] & 0xffffu;
+                BlockData block { type };
+                if (length == 0 || length > 256 - z)
                 {
-                    add_block(BlockID { x, y, z }, BlockData { BlockType::stone_block });
+                    return false;
                 }
-                for (; z < h; z++)
+                uint32_t end = z + length;
+                if (type != 0)
                 {
-                    add_block(BlockID { x, y, z }, BlockData { BlockType::dirt_block });
+                    outline.tops[x][y] = static_cast<uint16_t>(end);
                 }
-
-                if (z < 24)
+                if ((BlockRegistry::flags(type & (BlockRegistry::MAX_TYPES - 1)) & BLOCK_TICKING) != 0)
                 {
-                    for (; z < 24; z++)
-                    {
-                        add_block(BlockID { x, y, z }, BlockData { BlockType::water_block });
-                    }
+                    outline.ticking_sections |= section_mask(z, end - 1);
                 }
-                else
+                for (; z < end; z++)
                 {
-                    add_block(BlockID { x, y, z }, BlockData { BlockType::grass_block });
-                    auto p = dist(rng);
-                    if (p == 1)
-                    {
-                        add_block(BlockID { x, y, z + 1 }, BlockData { BlockType::flower });
-                    }
-                    else if (p <= 10)
-                    {
-                        add_block(BlockID { x, y, z + 1 }, BlockData { BlockType::grass });
-                    }
+                    column[z] = block;
                 }
             }
         }
     }
+    return i == runs.size();
 }
 
-Chunk::~Chunk()
+// Fills blocks with the chunk as it is without player edits, from DB::baked if it was pregenerated.
+static void generate(ChunkID const& chunk_id, ChunkBlocks& blocks, Outline& outline)
+{
+    auto it = DB::ins().baked.find(chunk_id);
+    if (it != DB::ins().baked.end())
+    {
+        if (decode_runs(it->second, blocks, outline))
+        {
+            return;
+        }
+        cerr << "Corrupt baked chunk " << static_cast<int32_t>(chunk_id.x) << ", " << static_cast<int32_t>(chunk_id.y)
+             << ", generating it" << endl;
+        for (auto& row : blocks)
+            for (auto& column : row)
+                column.fill(BlockData {});
+        outline = Outline {};
+    }
+    generate_terrain(chunk_id, blocks, outline);
+}
+
+// Marshals every block that differs from the generated terrain, deleted blocks included.
+static vector<uint32_t> diff(ChunkID const& chunk_id, ChunkBlocks const& blocks)
 {
+    auto    generated = make_unique<ChunkBlocks>();
+    Outline outline;
+    generate(chunk_id, *generated, outline);
+
     vector<uint32_t> chunk_data {};
 
     for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
@@ -110,7 +201,7 @@ Chunk::~Chunk()
         {
             for (uint16_t z = 0; z < 256; z++)
             {
-                if (auto const& block = blocks[x][y][z]; !block.is_null())
+                if (auto const& block = blocks[x][y][z]; block != (*generated)[x][y][z])
                 {
                     chunk_data.push_back(marshal(x, y, z, block));
                 }
@@ -118,5 +209,122 @@ Chunk::~Chunk()
         }
     }
 
-    DB::ins().chunks.insert_or_assign(chunk_id, chunk_data);
+    return chunk_data;
+}
+
+Chunk::Chunk(ChunkID const& chunk_id) : chunk_id(chunk_id)
+{
+    PROFILE_ZONE("Chunk::Chunk");
+    Memory::ins().add(MemoryCategory::chunks, sizeof(Chunk));
+    MeshCache::ins().prefetch(chunk_id);
+
+    Outline outline;
+    {
+        PROFILE_ZONE("generate");
+        generate(chunk_id, blocks, outline);
+    }
+    ticking_sections = outline.ticking_sections;
+
+    auto it = DB::ins().chunks.find(chunk_id);
+    if (it != DB::ins().chunks.end())
+    {
+        for (uint32_t const& b : it->second)
+        {
+            auto [x, y, z, block] = unmarshal(b);
+            blocks[x][y][z]       = block;
+            if (!block.is_null())
+                outline.tops[x][y] = max<uint16_t>(outline.tops[x][y], z + 1);
+            if (block.is_ticking())
+                ticking_sections |= section_mask(z, z);
+            if (block.emission() != 0)
+                emitting_sections |= section_mask(z, z);
+        }
+    }
+
+    init(outline.tops);
+}
+
+Chunk::Chunk(ChunkSnapshot const& snapshot) : chunk_id(snapshot.chunk_id), replica(true)
+{
+    PROFILE_ZONE("Chunk::Chunk, snapshot");
+    Memory::ins().add(MemoryCategory::chunks, sizeof(Chunk));
+    MeshCache::ins().prefetch(chunk_id);
+
+    ChunkHeights tops {};
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        if (snapshot.sections[s] == nullptr)
+            continue;
+
+        auto const& section = *snapshot.sections[s];
+        for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+        {
+            for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+            {
+                copy_n(&section[x << 8u | y << 4u], 16, &blocks[x][y][s * 16]);
+                tops[x][y] = static_cast<uint16_t>(s * 16 + 16);
+            }
+        }
+        for (BlockData const& block : section)
+        {
+            if (block.is_ticking())
+                ticking_sections |= section_mask(s * 16, s * 16);
+            if (block.emission() != 0)
+                emitting_sections |= section_mask(s * 16, s * 16);
+        }
+    }
+
+    init(tops);
+}
+
+void Chunk::init(ChunkHeights const& tops)
+{
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            scan_heights(x, y, tops[x][y]);
+        }
+    }
+
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        section_blocks[s] = s * 16 >= height_max ? 0 : UNCOUNTED;
+    }
+
+    PROFILE_ZONE("init_light");
+    init_light();
+}
+
+Chunk::~Chunk()
+{
+    Memory::ins().add(MemoryCategory::chunks, -static_cast<int64_t>(sizeof(Chunk)));
+    MeshCache::ins().discard(chunk_id);
+
+    if (!modified || replica)
+    {
+        return;
+    }
+    PROFILE_ZONE("Chunk::~Chunk, diff");
+
+    DB::ins().store(chunk_id, diff(chunk_id, blocks));
+}
+
+vector<uint32_t> Chunk::diff_snapshot(ChunkID const& chunk_id, vector<uint32_t> const& snapshot)
+{
+    auto blocks = make_unique<ChunkBlocks>();
+    for (uint32_t const& b : snapshot)
+    {
+        auto [x, y, z, block] = unmarshal(b);
+        (*blocks)[x][y][z]    = block;
+    }
+    return diff(chunk_id, *blocks);
+}
+
+vector<uint32_t> Chunk::bake(ChunkID const& chunk_id)
+{
+    auto    blocks = make_unique<ChunkBlocks>();
+    Outline outline;
+    generate_terrain(chunk_id, *blocks, outline);
+    return encode_runs(*blocks);
 }
@@ -0,0 +1,75 @@
+#include "chunk_map.hpp"
+
+#include <algorithm>
+
+#include "profile.hpp"
+
+Chunk* ChunkMap::put(Chunk* chunk)
+{
+    Chunk* old = take(chunk->chunk_id);
+    place(chunk, static_cast<uint32_t>(list.size()));
+    list.push_back(chunk);
+    return old;
+}
+
+Chunk* ChunkMap::take(ChunkID const& chunk_id)
+{
+    Chunk* chunk = get(chunk_id);
+    if (chunk == nullptr)
+    {
+        return nullptr;
+    }
+
+    // The last chunk of the list fills the hole.
+    uint32_t i    = index_of(chunk_id);
+    Chunk*   last = list.back();
+    list[i]       = last;
+    index_of(last->chunk_id) = i;
+    list.pop_back();
+
+    if (in_grid(chunk_id))
+        slots[slot(chunk_id)] = nullptr;
+    else
+        overflow.erase(chunk_id);
+    return chunk;
+}
+
+void ChunkMap::follow(ChunkID const& center_id, int32_t range)
+{
+    if (in_grid(center_id.add(-range, -range)) && in_grid(center_id.add(range, range)))
+    {
+        return;
+    }
+
+    PROFILE_ZONE("ChunkMap::follow");
+
+    // Every chunk is taken out and placed again, those that stay in the window in the slots they had.
+    fill(slots.begin(), slots.end(), nullptr);
+    overflow.clear();
+    origin = center_id.add(-static_cast<int32_t>(GRID_SIZE / 2), -static_cast<int32_t>(GRID_SIZE / 2));
+    for (uint32_t i = 0; i < list.size(); i++)
+    {
+        place(list[i], i);
+    }
+}
+
+void ChunkMap::clear()
+{
+    // The chunks may be deleted already.
+    fill(slots.begin(), slots.end(), nullptr);
+    overflow.clear();
+    list.clear();
+}
+
+void ChunkMap::place(Chunk* chunk, uint32_t i)
+{
+    if (in_grid(chunk->chunk_id))
+    {
+        slots[slot(chunk->chunk_id)]        = chunk;
+        slot_indices[slot(chunk->chunk_id)] = i;
+    }
+    else
+    {
+        overflow.emplace(chunk->chunk_id, pair { chunk, i });
+    }
+}
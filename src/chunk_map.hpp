@@ -0,0 +1,111 @@
+#ifndef CHUNK_MAP_HPP
+#define CHUNK_MAP_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include "chunk.hpp"
+#include "config.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * The loaded chunks, by id. The chunks of a GRID_SIZE * GRID_SIZE window are kept in a grid wrapping around at its edges,
+ * a chunk in the slot of its coordinates modulo GRID_SIZE, so that a lookup is a range check and two masks, and the
+ * chunks that stay in the window when it moves stay in their slots. The few outside it, around the other players of a
+ * server or left behind by a teleport, are kept in a hash map. Iteration goes over a dense list of all of them, in no
+ * particular order.
+ */
+class ChunkMap : private NonCopy<ChunkMap>
+{
+public:
+    static constexpr uint32_t GRID_BITS = 7, GRID_SIZE = 1u << GRID_BITS;
+
+    // The windows of the player and of where it is heading, with their unload margins, fit in the grid.
+    static_assert(2 * (LOAD_RANGE_MAX + UNLOAD_MARGIN + STREAM_AHEAD_MAX + 1) + 1 <= static_cast<int32_t>(GRID_SIZE));
+
+private:
+    static constexpr uint32_t SPAN = GRID_SIZE * CHUNK_WIDTH, SLOT_MASK = GRID_SIZE - 1;
+
+    // The chunk id of the corner of the window.
+    ChunkID origin { -static_cast<int32_t>(SPAN / 2), -static_cast<int32_t>(SPAN / 2) };
+
+    // The chunk in each slot of the window, and its index in list.
+    vector<Chunk*>   slots = vector<Chunk*>(GRID_SIZE * GRID_SIZE, nullptr);
+    vector<uint32_t> slot_indices = vector<uint32_t>(GRID_SIZE * GRID_SIZE, 0);
+
+    // Chunks out of the window, and their index in list.
+    unordered_map<ChunkID, pair<Chunk*, uint32_t>, ChunkID::Hasher> overflow {};
+
+    vector<Chunk*> list {};
+
+public:
+    [[nodiscard]] Chunk* get(ChunkID const& chunk_id) const
+    {
+        if (in_grid(chunk_id))
+        {
+            return slots[slot(chunk_id)];
+        }
+        if (overflow.empty())
+        {
+            return nullptr;
+        }
+        auto it = overflow.find(chunk_id);
+        return it == overflow.end() ? nullptr : it->second.first;
+    }
+
+    // Adds chunk and returns the chunk it replaces, nullptr if there is none.
+    Chunk* put(Chunk* chunk);
+
+    // Removes the chunk and returns it, nullptr if there is none.
+    Chunk* take(ChunkID const& chunk_id);
+
+    // Moves the window so that it is centered on center_id once the window up to range away from it would stick out of it.
+    void follow(ChunkID const& center_id, int32_t range);
+
+    // Forgets the chunks without deleting them.
+    void clear();
+
+    [[nodiscard]] size_t size() const
+    {
+        return list.size();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return list.empty();
+    }
+
+    [[nodiscard]] vector<Chunk*>::const_iterator begin() const
+    {
+        return list.begin();
+    }
+
+    [[nodiscard]] vector<Chunk*>::const_iterator end() const
+    {
+        return list.end();
+    }
+
+private:
+    [[nodiscard]] bool in_grid(ChunkID const& chunk_id) const
+    {
+        return chunk_id.x - origin.x < SPAN && chunk_id.y - origin.y < SPAN;
+    }
+
+    static uint32_t slot(ChunkID const& chunk_id)
+    {
+        return (chunk_id.x >> 4u & SLOT_MASK) << GRID_BITS | (chunk_id.y >> 4u & SLOT_MASK);
+    }
+
+    // Where list keeps the chunk at chunk_id.
+    uint32_t& index_of(ChunkID const& chunk_id)
+    {
+        return in_grid(chunk_id) ? slot_indices[slot(chunk_id)] : overflow.at(chunk_id).second;
+    }
+
+    // Adds a chunk not in the map at index i of list.
+    void place(Chunk* chunk, uint32_t i);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "chunk_renderer.hpp"
+
+#include "profile.hpp"
+
+ChunkVertices::ChunkVertices()
+{
+    vao = gen_vao();
+    vbo = gen_vbo();
+
+    // update vao
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BlockVertex), (GLvoid*) 0);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(BlockVertex), (GLvoid*) (3 * sizeof(GLfloat)));
+    glBindVertexArray(0);
+}
+
+ChunkVertices::~ChunkVertices()
+{
+    Memory::ins().add(MemoryCategory::gpu_buffers, -static_cast<int64_t>(sizeof(BlockVertex) * count));
+    del_vao(vao);
+    del_vbo(vbo);
+}
+
+void ChunkVertices::upload_data(BlockVertices const& data)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BlockVertex) * data.size(), data.data(), GL_STATIC_DRAW);
+
+    Memory::ins().add(MemoryCategory::gpu_buffers, (static_cast<int64_t>(data.size()) - static_cast<int64_t>(count)) * static_cast<int64_t>(sizeof(BlockVertex)));
+    count = data.size();
+}
+
+void ChunkVertices::render() const
+{
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, count);
+    glBindVertexArray(0);
+}
+
+void ChunkRenderer::render(BlockManager const& block_manager)
+{
+    PROFILE_ZONE("ChunkRenderer::render");
+
+    auto const& chunks = block_manager.get_chunks();
+
+    for (Chunk* chunk : chunks)
+    {
+        auto& v = chunk_vertices[chunk->chunk_id];
+        if (v == nullptr)
+        {
+            v = make_unique<ChunkVertices>();
+        }
+        if (chunk->take_vertices(upload_buffer))
+        {
+            PROFILE_ZONE("upload");
+            v->upload_data(upload_buffer);
+        }
+        v->render();
+    }
+
+    // Drop the buffers of chunks that were unloaded.
+    if (chunk_vertices.size() > chunks.size())
+    {
+        for (auto it = chunk_vertices.begin(); it != chunk_vertices.end();)
+        {
+            if (chunks.get(it->first) == nullptr)
+                it = chunk_vertices.erase(it);
+            else
+                ++it;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef CHUNK_RENDERER_HPP
+#define CHUNK_RENDERER_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "chunk.hpp"
+#include "opengl.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+class ChunkVertices : private NonCopy<ChunkVertices>
+{
+private:
+    GLuint vao;
+    GLuint vbo;
+    size_t count = 0;
+
+public:
+    ChunkVertices();
+
+    ~ChunkVertices();
+
+    void upload_data(BlockVertices const& data);
+
+    void render() const;
+};
+
+// Owns the GL buffers of the chunks in a BlockManager, uploading their meshes as they are rebuilt.
+class ChunkRenderer : private NonCopy<ChunkRenderer>
+{
+private:
+    unordered_map<ChunkID, unique_ptr<ChunkVertices>, ChunkID::Hasher> chunk_vertices {};
+
+    BlockVertices upload_buffer {};
+
+public:
+    void shutdown()
+    {
+        chunk_vertices.clear();
+    }
+
+    void render(BlockManager const& block_manager);
+};
+
+#endif
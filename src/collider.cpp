@@ -1,11 +1,9 @@
 #include "collider.hpp"
 
-#include "scene.hpp"
+#include "chunk_cursor.hpp"
 
-Collision Collider::collide(vec3 const& pos)
+Collision Collider::collide(BlockManager& block_manager, vec3 const& pos)
 {
-    auto& block_manager = Scene::ins().block_manager;
-
     float min_x   = pos.x - radius;
     float max_x   = pos.x + radius;
     float min_y   = pos.y - radius;
@@ -19,6 +17,8 @@ Collision Collider::collide(vec3 const& pos)
     auto  min_z_b = static_cast<uint8_t>(floor(min_z + 0.1f));
     auto  max_z_b = static_cast<uint8_t>(floor(max_z - 0.1f));
 
+    ChunkCursor cursor { block_manager, min_x_b, min_y_b, min_z_b };
+
     bool found = false;
     for (int32_t z = min_z_b; z <= max_z_b; z++)
     {
@@ -26,8 +26,8 @@ Collision Collider::collide(vec3 const& pos)
         {
             for (int32_t y = min_y_b; y <= max_y_b; y++)
             {
-                auto const* b = block_manager.get_block(BlockID { x, y, z });
-                if (b != nullptr && (b->is_opaque() && b->has_six_faces()))
+                auto const* b = cursor.get(x - min_x_b, y - min_y_b, z - min_z_b);
+                if (b != nullptr && b->is_solid())
                 {
                     found = true;
                     break;
@@ -36,19 +36,16 @@ Collision Collider::collide(vec3 const& pos)
         }
     }
 
+    // The column heightmaps answer this without walking down to the ground. Blocks at z = 0 are not ground.
     int32_t highest_z_b = 0;
-    for (int32_t z = min_z_b; z > 0; z--)
+    for (int32_t x = min_x_b; x <= max_x_b; x++)
     {
-        for (int32_t x = min_x_b; x <= max_x_b; x++)
+        for (int32_t y = min_y_b; y <= max_y_b; y++)
         {
-            for (int32_t y = min_y_b; y <= max_y_b; y++)
+            int32_t h = cursor.ground_height(x - min_x_b, y - min_y_b);
+            if (h > 1)
             {
-                auto const* b = block_manager.get_block(BlockID { x, y, z });
-                if (b != nullptr && (b->is_opaque() && b->has_six_faces()))
-                {
-                    highest_z_b = max(highest_z_b, z + 1);
-                    break;
-                }
+                highest_z_b = max(highest_z_b, h);
             }
         }
     }
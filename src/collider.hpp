@@ -5,10 +5,30 @@
 #include <cmath>
 
 #include "block_manager.hpp"
+#include "config.hpp"
 #include "math.hpp"
 
 using namespace std;
 
+// Movement state of objects and entities.
+enum State
+{
+    Fixed,
+    Normal,
+    Falling,
+};
+
+inline void transit_state(State& state, vec3& velocity, State new_state)
+{
+    switch (new_state)
+    {
+        case Fixed: velocity = vec3(0.f, 0.f, 0.f); break;
+        case Normal: velocity.z = 0.f; break;
+        case Falling: velocity.z -= gravity_acc; break;
+    }
+    state = new_state;
+}
+
 class Collision
 {
 public:
@@ -39,7 +59,7 @@ public:
     {
     }
 
-    Collision collide(vec3 const& pos);
+    Collision collide(BlockManager& block_manager, vec3 const& pos);
 };
 
 #endif
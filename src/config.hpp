@@ -8,7 +8,9 @@
 
 using namespace std;
 
-const string DB_PATH = "db";
+const string DB_PATH         = "db";
+const string TRACE_PATH      = "trace.json";
+const string MESH_CACHE_PATH = "mesh_cache";
 
 const string SHADER_BLOCK_VERTEX_PATH        = "shader/block_vertex.glsl";
 const string SHADER_BLOCK_FRAGMENT_PATH      = "shader/block_fragment.glsl";
@@ -37,7 +39,7 @@ constexpr float fall_speed    = 0.3f / 10.f;
 constexpr float jump_speed    = 0.2f / 10.f;
 constexpr float cam_rot_speed = 0.25f;
 
-constexpr uint32_t SUB_TEX_WIDTH = 16, SUB_TEX_HEIGHT = 16, N_TILES = 7;
+constexpr uint32_t SUB_TEX_WIDTH = 16, SUB_TEX_HEIGHT = 16, N_TILES = 8;
 constexpr int32_t  N_MIP_LEVEL = 5;
 
 constexpr uint8_t FACE_LEFT = 0, FACE_LEFT_BIT = 1u << 0u, //
@@ -55,23 +57,93 @@ enum BlockType : uint16_t
     water_block = 4,
     grass       = 5,
     flower      = 6,
+    lamp        = 7,
 };
 
+// Water levels: 0 is a source, 1 .. WATER_MAX_LEVEL flowing away from one, WATER_FALLING water with water above it.
+constexpr uint16_t WATER_MAX_LEVEL = 7, WATER_FALLING = 8;
+
+// Block updates run every BLOCK_TICK_MS, each tick stopping after BLOCK_TICK_BUDGET_US and leaving the rest for the next.
+constexpr float    BLOCK_TICK_MS        = 50.f;
+constexpr uint32_t BLOCK_TICK_BUDGET_US = 2000;
+constexpr uint32_t WATER_TICK_DELAY     = 5; // ticks
+
+// Chunk loading and meshing stop after CHUNK_UPDATE_BUDGET_US each frame, the rest waits for the next frame.
+constexpr uint32_t CHUNK_UPDATE_BUDGET_US = 4000;
+
+// Jobs still queued once the world is updated run on the main thread until the update took UPDATE_BUDGET_US of the frame.
+constexpr uint32_t UPDATE_BUDGET_US = CHUNK_UPDATE_BUDGET_US + BLOCK_TICK_BUDGET_US;
+
+// Memory use is printed every MEMORY_REPORT_S, and on F10. 0 only prints it on F10.
+constexpr uint64_t MEMORY_REPORT_S = 60;
+
+// Chunk meshes cached on disk take up to MESH_CACHE_MIB, see MeshCache.
+constexpr uint64_t MESH_CACHE_MIB = 512;
+
+// Chunk streaming looks STREAM_LOOKAHEAD_MS ahead of a moving player, by STREAM_AHEAD_MAX chunks at most, and counts chunks
+// behind the camera up to 1 + STREAM_BEHIND_WEIGHT times as far.
+constexpr float   STREAM_LOOKAHEAD_MS = 1000.f, STREAM_BEHIND_WEIGHT = 1.f;
+constexpr int32_t STREAM_AHEAD_MAX    = 4;
+
+// The load range, in chunks, can be set from LOAD_RANGE_MIN to LOAD_RANGE_MAX. Chunks are unloaded once UNLOAD_MARGIN
+// chunks out of it.
+constexpr int32_t LOAD_RANGE_MIN = 4, LOAD_RANGE_MAX = 32, UNLOAD_MARGIN = 2;
+
+// RangeController grows the load range while frames take less than RANGE_GROW_BELOW of FRAME_TIME_TARGET_MS and another
+// ring of chunks fits in MEMORY_BUDGET_MIB, and shrinks it while frames take longer than the target or memory is over
+// the budget. It waits RANGE_HOLD_MS after each change for the loads it started to settle.
+constexpr bool    RANGE_ADAPTIVE       = true;
+constexpr float   FRAME_TIME_TARGET_MS = 1000.f / 60.f;
+constexpr float   RANGE_GROW_BELOW     = 0.6f;
+constexpr float   RANGE_HOLD_MS        = 2000.f;
+constexpr int64_t MEMORY_BUDGET_MIB    = 2048;
+
+// How frames are presented, cycled with F4: synced to the display, as fast as they can run, or limited to FRAME_LIMIT_FPS
+// by sleeping until FRAME_SPIN_US before each frame's start and spinning the rest. The CPU runs at most FRAMES_IN_FLIGHT
+// frames ahead of the GPU, 0 waits for every frame to finish. Frame times and the latency from input to swap are printed
+// every FRAME_REPORT_S, and on F10. 0 only prints them on F10.
+enum class PresentMode : uint8_t
+{
+    vsync,
+    uncapped,
+    limited,
+};
+constexpr PresentMode PRESENT_MODE     = PresentMode::vsync;
+constexpr float       FRAME_LIMIT_FPS  = 120.f;
+constexpr uint32_t    FRAME_SPIN_US    = 2000;
+constexpr uint32_t    FRAMES_IN_FLIGHT = 1;
+constexpr uint64_t    FRAME_REPORT_S   = 10;
+
+// craft-server ticks every SERVER_TICK_MS, loading chunks for SERVER_LOAD_BUDGET_US of each tick. It sends each client at
+// most SERVER_SEND_BUDGET bytes a tick, and a delta of more than SERVER_DELTA_MAX blocks as the whole chunk.
+constexpr uint16_t SERVER_PORT           = 29500;
+constexpr float    SERVER_TICK_MS        = BLOCK_TICK_MS;
+constexpr uint32_t SERVER_LOAD_BUDGET_US = 20000;
+constexpr size_t   SERVER_SEND_BUDGET    = 64 * 1024;
+constexpr size_t   SERVER_DELTA_MAX      = 2048;
+
+// Light levels go from 0 to LIGHT_MAX. A block's light is packed in a byte, sky light in the low 4 bits and the light of
+// emitting blocks in the high 4 bits.
+constexpr uint8_t LIGHT_MAX = 15, SKY_LIGHT_SHIFT = 0, BLOCK_LIGHT_SHIFT = 4;
+
 struct BlockConfig
 {
     bool               is_opaque;
     bool               has_six_faces;
     array<uint32_t, 6> tex;
+    bool               is_ticking; // Has block updates, see BlockManager::tick().
+    uint8_t            emission;   // Block light it gives off, 0 .. LIGHT_MAX.
 };
 
-constexpr array<BlockConfig, 7> block_config { {
+inline constexpr array<BlockConfig, 8> block_config { {
     {},
-    { true, true, { { 1, 1, 1, 1, 2, 0 } } },
-    { true, true, { { 2, 2, 2, 2, 2, 2 } } },
-    { true, true, { { 3, 3, 3, 3, 3, 3 } } },
-    { false, true, { { 4, 4, 4, 4, 4, 4 } } },
-    { true, false, { { 5 } } },
-    { true, false, { { 6 } } },
+    { true, true, { { 1, 1, 1, 1, 2, 0 } }, false, 0 },
+    { true, true, { { 2, 2, 2, 2, 2, 2 } }, false, 0 },
+    { true, true, { { 3, 3, 3, 3, 3, 3 } }, false, 0 },
+    { false, true, { { 4, 4, 4, 4, 4, 4 } }, true, 0 },
+    { true, false, { { 5 } }, false, 0 },
+    { true, false, { { 6 } }, false, 0 },
+    { true, true, { { 7, 7, 7, 7, 7, 7 } }, false, LIGHT_MAX },
 } };
 
 #endif
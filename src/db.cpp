@@ -1,7 +1,20 @@
+#include <exception>
 #include <fstream>
+#include <iostream>
 
 #include "config.hpp"
 #include "db.hpp"
+#include "memory.hpp"
+#include "profile.hpp"
+
+static int64_t buffer_bytes(vector<uint32_t> const& buffer)
+{
+    return static_cast<int64_t>(buffer.capacity() * sizeof(uint32_t));
+}
+
+// "craftdb\0", followed by the format version.
+constexpr uint64_t DB_MAGIC   = 0x0062'6474'6661'7263;
+constexpr uint32_t DB_VERSION = 3;
 
 class DBFile
 {
@@ -9,9 +22,9 @@ private:
     fstream db;
 
 public:
-    explicit DBFile(fstream::openmode mode)
+    DBFile(string const& path, fstream::openmode mode)
     {
-        db.open(DB_PATH, fstream::binary | mode);
+        db.open(path, fstream::binary | mode);
     }
 
     template<typename T>
@@ -26,6 +39,34 @@ public:
         db.read(reinterpret_cast<char*>(&p), sizeof(T) * n);
     }
 
+    void write_chunks(unordered_map<ChunkID, vector<uint32_t>, ChunkID::Hasher> const& chunks)
+    {
+        write(chunks.size());
+        for (auto const& p : chunks)
+        {
+            write(p.first);
+            write(p.second.size());
+            write(*p.second.data(), p.second.size());
+        }
+    }
+
+    void read_chunks(unordered_map<ChunkID, vector<uint32_t>, ChunkID::Hasher>& chunks)
+    {
+        size_t n_chunks;
+        read(n_chunks);
+        for (size_t i = 0; i < n_chunks; i++)
+        {
+            ChunkID chunk_id {};
+            read(chunk_id);
+            size_t n_blocks;
+            read(n_blocks);
+            auto& chunk = chunks[chunk_id];
+            chunk.resize(n_blocks);
+            read(*chunk.data(), n_blocks);
+            Memory::ins().add(MemoryCategory::db, buffer_bytes(chunk));
+        }
+    }
+
     fstream* operator->()
     {
         return &db;
@@ -34,43 +75,95 @@ public:
 
 void DB::init()
 {
-    DBFile db { fstream::in };
+    PROFILE_ZONE("DB::init");
+
+    DBFile db { path, fstream::in };
 
     if (!db->is_open() || db->eof())
         return;
 
-    size_t n_chunks;
-    db.read(n_chunks);
-    for (size_t i = 0; i < n_chunks; i++)
+    uint64_t magic = 0;
+    db.read(magic);
+
+    // Files without the header start with the chunk count and store every block of every chunk.
+    if (magic != DB_MAGIC)
+    {
+        db->seekg(0);
+        db.read_chunks(chunks);
+        for (auto it = chunks.begin(); it != chunks.end();)
+        {
+            Memory::ins().add(MemoryCategory::db, -buffer_bytes(it->second));
+            it->second = Chunk::diff_snapshot(it->first, it->second);
+            Memory::ins().add(MemoryCategory::db, buffer_bytes(it->second));
+            if (it->second.empty())
+                it = chunks.erase(it);
+            else
+                ++it;
+        }
+
+        vec3 _player_pos;
+        db.read(_player_pos);
+        player_pos = _player_pos;
+        return;
+    }
+
+    uint32_t version = 0;
+    db.read(version);
+    if (version < 2 || version > DB_VERSION)
     {
-        ChunkID chunk_id {};
-        db.read(chunk_id);
-        size_t n_blocks;
-        db.read(n_blocks);
-        auto& chunk = chunks[chunk_id];
-        chunk.resize(n_blocks);
-        db.read(*chunk.data(), n_blocks);
+        cerr << "Unsupported db version " << version << endl;
+        throw exception();
     }
 
-    vec3 _player_pos;
-    db.read(_player_pos);
-    player_pos = _player_pos;
+    // Version 2 has no seed, baked chunks or player position flag.
+    if (version >= 3)
+        db.read(seed);
+    db.read_chunks(chunks);
+    if (version >= 3)
+        db.read_chunks(baked);
+
+    bool has_player_pos = true;
+    if (version >= 3)
+        db.read(has_player_pos);
+    if (has_player_pos)
+    {
+        vec3 _player_pos;
+        db.read(_player_pos);
+        player_pos = _player_pos;
+    }
 }
 
 void DB::shutdown()
 {
-    DBFile db { fstream::out };
+    PROFILE_ZONE("DB::shutdown");
+
+    DBFile db { path, fstream::out };
 
     if (!db->is_open())
         return;
 
-    db.write(chunks.size());
-    for (auto const& p : chunks)
+    db.write(DB_MAGIC);
+    db.write(DB_VERSION);
+    db.write(seed);
+    db.write_chunks(chunks);
+    db.write_chunks(baked);
+
+    db.write(player_pos.has_value());
+    if (player_pos.has_value())
+        db.write(*player_pos);
+}
+
+void DB::store(ChunkID const& chunk_id, vector<uint32_t>&& data)
+{
+    auto it = chunks.find(chunk_id);
+    if (it != chunks.end())
     {
-        db.write(p.first);
-        db.write(p.second.size());
-        db.write(*p.second.data(), p.second.size());
+        Memory::ins().add(MemoryCategory::db, -buffer_bytes(it->second));
+        chunks.erase(it);
     }
+    if (data.empty())
+        return;
 
-    db.write(*player_pos);
+    Memory::ins().add(MemoryCategory::db, buffer_bytes(data));
+    chunks.emplace(chunk_id, move(data));
 }
@@ -2,10 +2,12 @@
 #define DB_HPP
 
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "chunk.hpp"
+#include "config.hpp"
 #include "math.hpp"
 #include "util.hpp"
 
@@ -14,13 +16,26 @@ using namespace std;
 class DB : public Singleton<DB>
 {
 public:
+    // Player edits: blocks that differ from the generated terrain, see Chunk::~Chunk.
     unordered_map<ChunkID, vector<uint32_t>, ChunkID::Hasher> chunks {};
 
+    // Pregenerated terrain, loaded instead of running the generator. See Chunk::bake.
+    unordered_map<ChunkID, vector<uint32_t>, ChunkID::Hasher> baked {};
+
+    uint32_t seed = 0;
+
     optional<vec3> player_pos {};
 
+    // File read by init() and written by shutdown().
+    string path = DB_PATH;
+
 public:
     void init();
 
+    // Replaces the edits of chunk_id, dropping the entry if there are none. The buffers of chunks and baked are counted in
+    // MemoryCategory::db when they are read or stored, not when the maps are edited directly.
+    void store(ChunkID const& chunk_id, vector<uint32_t>&& data);
+
     void shutdown();
 };
 
@@ -0,0 +1,192 @@
+#include "entity.hpp"
+
+#include <atomic>
+#include <cmath>
+
+#include "job.hpp"
+#include "profile.hpp"
+
+static uint32_t cell_hash(int32_t cx, int32_t cy)
+{
+    return static_cast<uint32_t>(cx) * 0x8da6'b343u ^ static_cast<uint32_t>(cy) * 0xd816'3841u;
+}
+
+static int32_t cell_coord(float v)
+{
+    return static_cast<int32_t>(floor(v / EntityManager::CELL_WIDTH));
+}
+
+void EntityManager::step(BlockManager& block_manager, float del_t, unordered_set<ChunkID, ChunkID::Hasher> const& changed_chunks)
+{
+    PROFILE_ZONE("EntityManager::step");
+
+    uint32_t n = size();
+
+    JobSystem::ins().parallel_for(n, BATCH_SIZE, n_threads, [&](uint32_t i) { move(block_manager, del_t, changed_chunks, i); });
+
+    build_spatial_hash();
+    push.resize(n);
+    JobSystem::ins().parallel_for(n, BATCH_SIZE, n_threads, [&](uint32_t i) { compute_push(i); });
+    JobSystem::ins().parallel_for(n, BATCH_SIZE, n_threads, [&](uint32_t i) { apply_push(block_manager, i); });
+}
+
+void EntityManager::move(BlockManager& block_manager, float del_t, unordered_set<ChunkID, ChunkID::Hasher> const& changed_chunks, uint32_t i)
+{
+    if (state[i] == State::Fixed)
+    {
+        return;
+    }
+
+    ChunkID chunk_id { static_cast<int32_t>(floor(pos[i].x)), static_cast<int32_t>(floor(pos[i].y)) };
+    if (is_asleep(i))
+    {
+        // Blocks may have been taken from under it.
+        if (changed_chunks.empty() || changed_chunks.count(chunk_id) == 0)
+        {
+            return;
+        }
+        rest_steps[i] = 0;
+    }
+
+    // Entities wait for the terrain under them to load.
+    if (block_manager.get_chunk(chunk_id) == nullptr)
+    {
+        return;
+    }
+
+    vec3 del_p = velocity[i] * del_t;
+    pos[i] += del_p;
+
+    Collision c = Collider { radius[i], height_u[i], height_l[i] }.collide(block_manager, pos[i]);
+    switch (state[i])
+    {
+        case State::Normal:
+            if (!c.is_grounded())
+            {
+                transit_state(state[i], velocity[i], State::Falling);
+            }
+            else if (c.found)
+            {
+                pos[i].x -= del_p.x;
+                pos[i].y -= del_p.y;
+            }
+            break;
+        case State::Falling:
+            if (c.is_grounded() && velocity[i].z < 0.f)
+            {
+                transit_state(state[i], velocity[i], State::Normal);
+                pos[i].z = c.grounded;
+            }
+            else if (!c.found)
+            {
+                velocity[i].z = max(-fall_speed, velocity[i].z - gravity_acc);
+            }
+            break;
+        default: break;
+    }
+
+    bool at_rest  = state[i] == State::Normal && velocity[i].x == 0.f && velocity[i].y == 0.f;
+    rest_steps[i] = at_rest ? rest_steps[i] + 1 : 0;
+}
+
+void EntityManager::build_spatial_hash()
+{
+    uint32_t n         = size();
+    uint32_t n_buckets = 1;
+    while (n_buckets < 2 * n)
+    {
+        n_buckets <<= 1u;
+    }
+
+    entity_bucket.resize(n);
+    cell_entities.resize(n);
+    cell_start.assign(n_buckets + 1, 0);
+    max_radius = 0.f;
+
+    // Counting sort by bucket, cell_start[b] ends up as the end of bucket b and is shifted back afterwards.
+    for (uint32_t i = 0; i < n; i++)
+    {
+        entity_bucket[i] = cell_hash(cell_coord(pos[i].x), cell_coord(pos[i].y)) & (n_buckets - 1);
+        cell_start[entity_bucket[i] + 1]++;
+        max_radius = max(max_radius, radius[i]);
+    }
+    for (uint32_t b = 0; b < n_buckets; b++)
+    {
+        cell_start[b + 1] += cell_start[b];
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        cell_entities[cell_start[entity_bucket[i]]++] = { pos[i].x, pos[i].y, pos[i].z - height_l[i], pos[i].z + height_u[i], radius[i], i, is_asleep(i) };
+    }
+    for (uint32_t b = n_buckets; b > 0; b--)
+    {
+        cell_start[b] = cell_start[b - 1];
+    }
+    cell_start[0] = 0;
+}
+
+void EntityManager::compute_push(uint32_t i)
+{
+    push[i] = vec3(0.f, 0.f, 0.f);
+
+    float x = pos[i].x, y = pos[i].y, z0 = pos[i].z - height_l[i], z1 = pos[i].z + height_u[i];
+    bool  asleep = is_asleep(i);
+
+    // Only cells within reach of the widest entity can hold an overlapping one, at most 3 * 3 as none is wider than a cell.
+    float    reach = radius[i] + max_radius;
+    auto     mask  = static_cast<uint32_t>(cell_start.size() - 2);
+    uint32_t buckets[9], n_buckets = 0;
+
+    for (int32_t cx = cell_coord(x - reach); cx <= cell_coord(x + reach); cx++)
+    {
+        for (int32_t cy = cell_coord(y - reach); cy <= cell_coord(y + reach); cy++)
+        {
+            // Distinct cells may share a bucket, each bucket is visited once.
+            uint32_t b = cell_hash(cx, cy) & mask;
+            if (find(buckets, buckets + n_buckets, b) != buckets + n_buckets)
+            {
+                continue;
+            }
+            buckets[n_buckets++] = b;
+
+            for (uint32_t k = cell_start[b]; k < cell_start[b + 1]; k++)
+            {
+                HashedEntity const& o = cell_entities[k];
+
+                float d_x = x - o.x, d_y = y - o.y, r = radius[i] + o.radius;
+                float d2  = d_x * d_x + d_y * d_y;
+                if (d2 >= r * r || o.i == i || (asleep && o.asleep) || z0 >= o.z1 || o.z0 >= z1)
+                {
+                    continue;
+                }
+
+                // Each entity of an overlapping pair moves half of the overlap away from the other.
+                float d = sqrt(d2);
+                if (d > 1e-4f)
+                {
+                    push[i] += vec3(d_x / d, d_y / d, 0.f) * ((r - d) * 0.5f);
+                }
+                else
+                {
+                    push[i].x += (i < o.i ? -r : r) * 0.5f;
+                }
+            }
+        }
+    }
+}
+
+void EntityManager::apply_push(BlockManager& block_manager, uint32_t i)
+{
+    if (push[i].x == 0.f && push[i].y == 0.f)
+    {
+        return;
+    }
+
+    // Entities are not pushed into blocks.
+    vec3 p = pos[i] + push[i];
+    if (!Collider { radius[i], height_u[i], height_l[i] }.collide(block_manager, p).found)
+    {
+        pos[i]        = p;
+        rest_steps[i] = 0;
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef ENTITY_HPP
+#define ENTITY_HPP
+
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "collider.hpp"
+#include "config.hpp"
+#include "math.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * Mobs and dropped items, stored as one array per field so that a physics step streams through them. An entity is an
+ * index into the arrays; remove() moves the last entity into the freed index.
+ */
+class EntityManager : private NonCopy<EntityManager>
+{
+public:
+    // Steps an entity has to spend standing still before it stops being simulated.
+    static constexpr uint16_t SLEEP_STEPS = 30;
+
+    // Side of a spatial hash cell, no entity may be wider.
+    static constexpr float CELL_WIDTH = 1.f;
+
+    // Entities per batch of the parallel steps.
+    static constexpr uint32_t BATCH_SIZE = 512;
+
+    vector<vec3>  pos {};
+    vector<vec3>  velocity {};
+    vector<State> state {};
+
+    // Cylinder collider extents, as in Collider.
+    vector<float> radius {};
+    vector<float> height_u {};
+    vector<float> height_l {};
+
+    // Consecutive steps at rest, the entity is asleep once it reaches SLEEP_STEPS.
+    vector<uint16_t> rest_steps {};
+
+    uint32_t n_threads = max(1u, thread::hardware_concurrency());
+
+private:
+    // Horizontal push out of overlapping entities, computed for every entity before any is moved.
+    vector<vec3> push {};
+
+    // What the broadphase reads of an entity, copied out so that a bucket is one contiguous run.
+    struct HashedEntity
+    {
+        float    x, y, z0, z1, radius;
+        uint32_t i;
+        bool     asleep;
+    };
+
+    // Spatial hash: entities sorted by bucket, bucket b holding cell_entities[cell_start[b] .. cell_start[b + 1]).
+    vector<uint32_t>     cell_start {};
+    vector<HashedEntity> cell_entities {};
+    vector<uint32_t>     entity_bucket {};
+    float                max_radius = 0.f;
+
+public:
+    // Throws if r is over CELL_WIDTH / 2.
+    uint32_t add(vec3 const& p, float r, float h_u, float h_l)
+    {
+        if (!(r <= CELL_WIDTH / 2.f))
+        {
+            cerr << "Entity radius " << r << " is over " << CELL_WIDTH / 2.f << endl;
+            throw exception();
+        }
+        pos.push_back(p);
+        velocity.emplace_back(0.f, 0.f, 0.f);
+        state.push_back(State::Falling);
+        radius.push_back(r);
+        height_u.push_back(h_u);
+        height_l.push_back(h_l);
+        rest_steps.push_back(0);
+        return static_cast<uint32_t>(pos.size() - 1);
+    }
+
+    void remove(uint32_t i)
+    {
+        auto move_last = [&](auto& v) {
+            v[i] = v.back();
+            v.pop_back();
+        };
+        move_last(pos);
+        move_last(velocity);
+        move_last(state);
+        move_last(radius);
+        move_last(height_u);
+        move_last(height_l);
+        move_last(rest_steps);
+    }
+
+    void clear()
+    {
+        pos.clear();
+        velocity.clear();
+        state.clear();
+        radius.clear();
+        height_u.clear();
+        height_l.clear();
+        rest_steps.clear();
+    }
+
+    [[nodiscard]] uint32_t size() const
+    {
+        return static_cast<uint32_t>(pos.size());
+    }
+
+    void set_velocity(uint32_t i, vec3 const& v)
+    {
+        velocity[i]   = v;
+        rest_steps[i] = 0;
+    }
+
+    [[nodiscard]] bool is_asleep(uint32_t i) const
+    {
+        return rest_steps[i] >= SLEEP_STEPS;
+    }
+
+    /*
+     * Moves every awake entity by del_t ms against the terrain like Scene::update moves objects, then pushes overlapping
+     * entities apart. Sleeping entities in changed_chunks wake up.
+     */
+    void step(BlockManager& block_manager, float del_t, unordered_set<ChunkID, ChunkID::Hasher> const& changed_chunks);
+
+private:
+    void move(BlockManager& block_manager, float del_t, unordered_set<ChunkID, ChunkID::Hasher> const& changed_chunks, uint32_t i);
+
+    void build_spatial_hash();
+
+    void compute_push(uint32_t i);
+
+    void apply_push(BlockManager& block_manager, uint32_t i);
+};
+
+#endif
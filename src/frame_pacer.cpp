@@ -0,0 +1,130 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "profile.hpp"
+
+void FramePacer::set_mode(PresentMode m)
+{
+    mode = m;
+    glfwSwapInterval(mode == PresentMode::vsync ? 1 : 0);
+    next_start = Clock::now();
+}
+
+void FramePacer::cycle_mode()
+{
+    set_mode(static_cast<PresentMode>((static_cast<uint8_t>(mode) + 1) % 3));
+    cerr << "Present mode " << name(mode) << endl;
+}
+
+void FramePacer::wait()
+{
+    if (mode != PresentMode::limited)
+        return;
+
+    PROFILE_ZONE("FramePacer::wait");
+
+    // Sleeping wakes up late by up to the scheduler's tick, so it stops FRAME_SPIN_US short and spins the rest.
+    auto spin = chrono::microseconds(FRAME_SPIN_US);
+    if (Clock::now() < next_start - spin)
+        this_thread::sleep_until(next_start - spin);
+    while (Clock::now() < next_start)
+    {
+    }
+
+    // A frame that ran late is not made up for.
+    auto period = chrono::duration_cast<Clock::duration>(chrono::duration<float>(1.f / FRAME_LIMIT_FPS));
+    next_start  = max(next_start + period, Clock::now());
+}
+
+// Appends t, dropping the older half of v once it is full.
+static void add_sample(vector<float>& v, float t, size_t max_samples)
+{
+    if (v.size() >= max_samples)
+        v.erase(v.begin(), v.begin() + static_cast<ptrdiff_t>(v.size() / 2));
+    v.push_back(t);
+}
+
+void FramePacer::presented(optional<Clock::time_point> input_time)
+{
+    auto now = Clock::now();
+    add_sample(frame_ms, chrono::duration<float, milli>(now - last_swap).count(), MAX_SAMPLES);
+    last_swap = now;
+    if (input_time.has_value())
+        add_sample(latency_ms, chrono::duration<float, milli>(now - *input_time).count(), MAX_SAMPLES);
+
+    PROFILE_ZONE("FramePacer::fence");
+    if (FRAMES_IN_FLIGHT == 0)
+    {
+        glFinish();
+        return;
+    }
+    fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    while (fences.size() > FRAMES_IN_FLIGHT)
+    {
+        // A second at most, a lost context does not hang the loop.
+        glClientWaitSync(fences.front(), GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+        glDeleteSync(fences.front());
+        fences.pop_front();
+    }
+}
+
+void FramePacer::shutdown()
+{
+    for (GLsync fence : fences)
+    {
+        glDeleteSync(fence);
+    }
+    fences.clear();
+}
+
+void FramePacer::report(ostream& out)
+{
+    if (frame_ms.empty())
+        return;
+
+    auto percentile = [](vector<float>& v, size_t p) { return v.empty() ? 0.f : v[v.size() * p / 100]; };
+
+    float total = 0.f;
+    for (float t : frame_ms)
+    {
+        total += t;
+    }
+    float latency = 0.f;
+    for (float t : latency_ms)
+    {
+        latency += t;
+    }
+    sort(frame_ms.begin(), frame_ms.end());
+    sort(latency_ms.begin(), latency_ms.end());
+
+    char line[160];
+    snprintf(line,
+             sizeof(line),
+             "Frames (%s): %.1f fps, %.2f ms p50, %.2f ms p99; input to swap %.2f ms mean, %.2f ms p99 over %zu frames\n",
+             name(mode),
+             static_cast<float>(frame_ms.size()) * 1000.f / total,
+             percentile(frame_ms, 50),
+             percentile(frame_ms, 99),
+             latency_ms.empty() ? 0.f : latency / static_cast<float>(latency_ms.size()),
+             percentile(latency_ms, 99),
+             latency_ms.size());
+    out << line << flush;
+
+    frame_ms.clear();
+    latency_ms.clear();
+}
+
+char const* FramePacer::name(PresentMode m)
+{
+    switch (m)
+    {
+        case PresentMode::vsync: return "vsync";
+        case PresentMode::uncapped: return "uncapped";
+        case PresentMode::limited: return "limited";
+        default: return "";
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "config.hpp"
+#include "opengl.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * Paces the frames of the main loop, see PresentMode. wait() starts a frame, presented() ends it after the swap. Each
+ * swap is followed by a fence, and presented() waits for the fence of FRAMES_IN_FLIGHT frames ago, so that the driver
+ * cannot queue frames rendered with input older than that.
+ */
+class FramePacer : public Singleton<FramePacer>
+{
+private:
+    using Clock = chrono::steady_clock;
+
+    PresentMode mode = PRESENT_MODE;
+
+    Clock::time_point next_start = Clock::now();
+    Clock::time_point last_swap  = Clock::now();
+
+    deque<GLsync> fences {};
+
+    // Since the last report: time between swaps, and from the first input of a frame to its swap, ms. Without reports
+    // only the last MAX_SAMPLES / 2 to MAX_SAMPLES are kept.
+    static constexpr size_t MAX_SAMPLES = 1u << 16u;
+    vector<float>           frame_ms {};
+    vector<float>           latency_ms {};
+
+public:
+    // Needs the GL context.
+    void set_mode(PresentMode m);
+
+    [[nodiscard]] PresentMode get_mode() const
+    {
+        return mode;
+    }
+
+    // vsync, uncapped, limited, then vsync again.
+    void cycle_mode();
+
+    // Before polling the input of a frame. Returns once the limited rate lets the frame start.
+    void wait();
+
+    // After the swap of a frame with its earliest input at input_time, nullopt for a frame without input.
+    void presented(optional<Clock::time_point> input_time);
+
+    void shutdown();
+
+    // Frame rate, frame time and input latency percentiles since the last report.
+    void report(ostream& out);
+
+    static char const* name(PresentMode m);
+};
+
+#endif
@@ -1,11 +1,47 @@
 #include "input.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+#include "db.hpp"
+#include "frame_pacer.hpp"
+#include "memory.hpp"
+#include "mesh_cache.hpp"
 #include "player.hpp"
+#include "profile.hpp"
 #include "scene.hpp"
 
 static bool window_exclusive = false;
 
-void key_callback(GLFWwindow* window, int key, int, int action, int)
+// By hand, which turns RangeController off.
+static void change_range(int32_t by)
+{
+    Scene::ins().range_controller.enabled = false;
+    Scene::ins().set_range(Scene::ins().block_manager.get_range() + by);
+}
+
+// A replay follows the recorded range changes instead, see InputEventType::range.
+static void toggle_adaptive_range()
+{
+    if (InputStream::ins().is_replaying())
+        return;
+
+    bool& enabled = Scene::ins().range_controller.enabled;
+    enabled       = !enabled;
+    cerr << "Adaptive load range " << (enabled ? "on" : "off") << endl;
+}
+
+// A replay runs uncapped whatever the session used.
+static void cycle_present_mode()
+{
+    if (!InputStream::ins().is_replaying())
+        FramePacer::ins().cycle_mode();
+}
+
+static void on_key(GLFWwindow* window, int key, int action)
 {
     if (window_exclusive)
     {
@@ -22,6 +58,18 @@ void key_callback(GLFWwindow* window, int key, int, int action, int)
                 case GLFW_KEY_A: Player::ins().start_move_left(); break;
                 case GLFW_KEY_D: Player::ins().start_move_right(); break;
                 case GLFW_KEY_SPACE: Player::ins().jump(); break;
+                case GLFW_KEY_F4: cycle_present_mode(); break;
+                case GLFW_KEY_F5: change_range(-1); break;
+                case GLFW_KEY_F6: change_range(1); break;
+                case GLFW_KEY_F7: toggle_adaptive_range(); break;
+                case GLFW_KEY_F8: Profiler::ins().set_enabled(!Profiler::ins().is_enabled()); break;
+                case GLFW_KEY_F9: Profiler::ins().request_trace(); break;
+                case GLFW_KEY_F10:
+                    Memory::ins().report(cerr);
+                    FramePacer::ins().report(cerr);
+                    if (MeshCache::ins().is_enabled())
+                        MeshCache::ins().report(cerr);
+                    break;
             }
         }
         else if (action == GLFW_RELEASE)
@@ -42,12 +90,24 @@ void key_callback(GLFWwindow* window, int key, int, int action, int)
             switch (key)
             {
                 case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
+                case GLFW_KEY_F4: cycle_present_mode(); break;
+                case GLFW_KEY_F5: change_range(-1); break;
+                case GLFW_KEY_F6: change_range(1); break;
+                case GLFW_KEY_F7: toggle_adaptive_range(); break;
+                case GLFW_KEY_F8: Profiler::ins().set_enabled(!Profiler::ins().is_enabled()); break;
+                case GLFW_KEY_F9: Profiler::ins().request_trace(); break;
+                case GLFW_KEY_F10:
+                    Memory::ins().report(cerr);
+                    FramePacer::ins().report(cerr);
+                    if (MeshCache::ins().is_enabled())
+                        MeshCache::ins().report(cerr);
+                    break;
             }
         }
     }
 }
 
-void cursor_pos_callback(GLFWwindow*, double posx, double posy)
+static void on_cursor_pos(double posx, double posy)
 {
     static double last_posx = posx, last_posy = posy;
 
@@ -62,7 +122,7 @@ void cursor_pos_callback(GLFWwindow*, double posx, double posy)
     }
 }
 
-void mouse_button_callback(GLFWwindow* window, int button, int action, int)
+static void on_mouse_button(GLFWwindow* window, int button, int action)
 {
     if (window_exclusive)
     {
@@ -77,8 +137,8 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int)
                         BlockData const* block    = Scene::ins().block_manager.get_block(block_id);
                         if (block != nullptr)
                         {
-                            Player::ins().new_block = *block;
-                            Scene::ins().block_manager.del_block(block_id);
+                            Player::ins().new_block = BlockData { block->type() };
+                            Scene::ins().del_block(block_id);
                         }
                     }
                     break;
@@ -89,7 +149,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int)
                         BlockData const* block    = Scene::ins().block_manager.get_block(block_id);
                         if (block != nullptr && !(block->is_opaque() && block->has_six_faces()))
                         {
-                            Scene::ins().block_manager.add_block(block_id, BlockData { Player::ins().new_block });
+                            Scene::ins().add_block(block_id, BlockData { Player::ins().new_block });
                         }
                         else
                         {
@@ -97,7 +157,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int)
                             block    = Scene::ins().block_manager.get_block(block_id);
                             if (block == nullptr || !(block->is_opaque() && block->has_six_faces()))
                             {
-                                Scene::ins().block_manager.add_block(block_id, BlockData { Player::ins().new_block });
+                                Scene::ins().add_block(block_id, BlockData { Player::ins().new_block });
                             }
                         }
                     }
@@ -120,9 +180,177 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int)
     }
 }
 
-void scroll_callback(GLFWwindow*, double, double yoffset)
+static void on_scroll(double yoffset)
+{
+    // Through every type but air.
+    auto& block = Player::ins().new_block;
+    auto  tot   = static_cast<uint32_t>(BlockRegistry::size() - 1);
+    block.set_type(static_cast<uint16_t>((block.type() - 1 + (yoffset < 0.f ? 1u : tot - 1u)) % tot + 1));
+}
+
+void key_callback(GLFWwindow* window, int key, int, int action, int)
+{
+    InputStream::ins().push(window, InputEvent { InputEventType::key, key, action, 0.0, 0.0, 0.0 });
+}
+
+void cursor_pos_callback(GLFWwindow* window, double posx, double posy)
+{
+    InputStream::ins().push(window, InputEvent { InputEventType::cursor_pos, 0, 0, posx, posy, 0.0 });
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int)
+{
+    InputStream::ins().push(window, InputEvent { InputEventType::mouse_button, button, action, 0.0, 0.0, 0.0 });
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    InputStream::ins().push(window, InputEvent { InputEventType::scroll, 0, 0, xoffset, yoffset, 0.0 });
+}
+
+// "craftrec", followed by the format version.
+constexpr uint64_t RECORD_MAGIC   = 0x6365'7274'6661'7263;
+constexpr uint32_t RECORD_VERSION = 2;
+
+void InputStream::record(string const& path)
+{
+    file.open(path, fstream::out | fstream::binary);
+    if (!file.is_open())
+    {
+        cerr << "Cannot write " << path << endl;
+        throw exception();
+    }
+    file.write(reinterpret_cast<char const*>(&RECORD_MAGIC), sizeof(RECORD_MAGIC));
+    file.write(reinterpret_cast<char const*>(&RECORD_VERSION), sizeof(RECORD_VERSION));
+
+    string db_path = path + ".db";
+    filesystem::remove(db_path);
+    if (filesystem::exists(DB::ins().path))
+        filesystem::copy_file(DB::ins().path, db_path);
+
+    mode = Mode::record;
+}
+
+void InputStream::replay(string const& path)
+{
+    file.open(path, fstream::in | fstream::binary);
+    uint64_t magic   = 0;
+    uint32_t version = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file || magic != RECORD_MAGIC || version != RECORD_VERSION)
+    {
+        cerr << "Cannot replay " << path << endl;
+        throw exception();
+    }
+
+    // A session cut short by a crash ends with its last whole event.
+    InputEvent event {};
+    while (file.read(reinterpret_cast<char*>(&event), sizeof(event)))
+    {
+        events.push_back(event);
+    }
+    file.close();
+
+    DB::ins().path = path + ".db";
+    mode           = Mode::replay;
+}
+
+void InputStream::push(GLFWwindow* window, InputEvent event)
+{
+    if (mode == Mode::replay)
+        return;
+
+    event.t = session_time();
+    if (!input_time.has_value())
+        input_time = chrono::steady_clock::now();
+    if (mode == Mode::record)
+        write(event);
+    dispatch(window, event);
+}
+
+void InputStream::record_range(int32_t range)
+{
+    if (mode == Mode::record)
+        write(InputEvent { InputEventType::range, range, 0, 0.0, 0.0, session_time() });
+}
+
+optional<float> InputStream::next_frame(GLFWwindow* window)
+{
+    using namespace std::chrono;
+
+    if (mode == Mode::replay)
+    {
+        auto now = steady_clock::now();
+        if (next != 0)
+            frame_times.push_back(duration<float, milli>(now - frame_start).count());
+        frame_start = now;
+
+        for (; next < events.size(); next++)
+        {
+            if (events[next].type == InputEventType::frame)
+                return static_cast<float>(events[next++].x);
+            dispatch(window, events[next]);
+        }
+        return nullopt;
+    }
+
+    uint64_t now   = time_now_ms();
+    auto     del_t = static_cast<float>(now - last_frame);
+    last_frame     = now;
+
+    if (mode == Mode::record)
+    {
+        write(InputEvent { InputEventType::frame, 0, 0, del_t, 0.0, session_time() });
+        // A crash keeps the session up to the last frame.
+        file.flush();
+    }
+    return del_t;
+}
+
+void InputStream::shutdown()
 {
-    auto&    type = Player::ins().new_block.type;
-    uint32_t tot  = block_config.size();
-    type          = (type - 1 + (yoffset < 0.f ? 1u : tot - 1u)) % tot + 1;
+    if (mode == Mode::record)
+        file.close();
+
+    if (mode != Mode::replay || frame_times.empty())
+        return;
+
+    float total = 0.f;
+    for (float t : frame_times)
+    {
+        total += t;
+    }
+    sort(frame_times.begin(), frame_times.end());
+    fprintf(stderr,
+            "Replayed %zu frames in %.2f s: %.2f ms mean, %.2f ms p50, %.2f ms p99, %.2f ms max\n",
+            frame_times.size(),
+            total / 1000.f,
+            total / static_cast<float>(frame_times.size()),
+            frame_times[frame_times.size() / 2],
+            frame_times[frame_times.size() * 99 / 100],
+            frame_times.back());
+}
+
+double InputStream::session_time() const
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void InputStream::write(InputEvent const& event)
+{
+    file.write(reinterpret_cast<char const*>(&event), sizeof(event));
+}
+
+void InputStream::dispatch(GLFWwindow* window, InputEvent const& event)
+{
+    switch (event.type)
+    {
+        case InputEventType::key: on_key(window, event.code, event.action); break;
+        case InputEventType::cursor_pos: on_cursor_pos(event.x, event.y); break;
+        case InputEventType::mouse_button: on_mouse_button(window, event.code, event.action); break;
+        case InputEventType::scroll: on_scroll(event.y); break;
+        case InputEventType::range: Scene::ins().set_range(event.code); break;
+        default: break;
+    }
 }
@@ -1,7 +1,17 @@
 #ifndef INPUT_HPP
 #define INPUT_HPP
 
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "opengl.hpp"
+#include "util.hpp"
+
+using namespace std;
 
 void key_callback(GLFWwindow* window, int key, int, int action, int);
 
@@ -11,4 +21,103 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int);
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
+enum class InputEventType : uint32_t
+{
+    frame, // end of a frame's input, x is the frame's time step in ms
+    key,
+    cursor_pos,
+    mouse_button,
+    scroll,
+    range, // the load range changed to code, by hand or by RangeController
+};
+
+struct InputEvent
+{
+    InputEventType type;
+    int32_t        code;   // key or button
+    int32_t        action; // GLFW_PRESS or GLFW_RELEASE
+    double         x, y;   // cursor position or scroll offsets
+    double         t;      // ms since the session started
+};
+
+/*
+ * Every GLFW input callback goes through the stream. A session can be recorded to a file, each event with its time, and
+ * the time step of every frame. Replaying it feeds the same events to the handlers in the same frames, and steps the
+ * world by the same times from the same db and load range, so it repeats the session's chunk loads, edits and frame
+ * workload. The live input is ignored meanwhile.
+ *
+ * Both step the world deterministically, see Scene::update(): a recording finishes the block ticks and chunk loads of every
+ * frame, as the replay does, instead of stopping wherever the time budgets ran out on the recording machine.
+ */
+class InputStream : public Singleton<InputStream>
+{
+private:
+    enum class Mode
+    {
+        live,
+        record,
+        replay,
+    };
+
+    Mode    mode = Mode::live;
+    fstream file {};
+
+    // Replay: the events of the session, and the next one to feed.
+    vector<InputEvent> events {};
+    size_t             next = 0;
+
+    chrono::steady_clock::time_point start      = chrono::steady_clock::now();
+    uint64_t                         last_frame = time_now_ms();
+
+    // Replay: wall time of every frame, ms.
+    vector<float>                    frame_times {};
+    chrono::steady_clock::time_point frame_start = chrono::steady_clock::now();
+
+    // Live: when the first input not presented yet came in.
+    optional<chrono::steady_clock::time_point> input_time {};
+
+public:
+    // Both are called before the db is loaded. Recording copies the db to path + ".db", and replaying loads that copy
+    // instead, without writing it back at shutdown.
+    void record(string const& path);
+
+    void replay(string const& path);
+
+    [[nodiscard]] bool is_recording() const
+    {
+        return mode == Mode::record;
+    }
+
+    [[nodiscard]] bool is_replaying() const
+    {
+        return mode == Mode::replay;
+    }
+
+    // From the GLFW callbacks.
+    void push(GLFWwindow* window, InputEvent event);
+
+    // From Scene::set_range(), a replay sets the same range at the same point of the session.
+    void record_range(int32_t range);
+
+    // Called once per frame after polling the events. Returns the time step of the frame in ms, nullopt once a replay is
+    // over.
+    optional<float> next_frame(GLFWwindow* window);
+
+    // When the earliest input since the last call came in, nullopt without any. Called once a frame is presented.
+    optional<chrono::steady_clock::time_point> take_input_time()
+    {
+        return exchange(input_time, nullopt);
+    }
+
+    // Ends a recording, prints the frame times of a replay.
+    void shutdown();
+
+private:
+    [[nodiscard]] double session_time() const;
+
+    void write(InputEvent const& event);
+
+    static void dispatch(GLFWwindow* window, InputEvent const& event);
+};
+
 #endif
@@ -0,0 +1,194 @@
+#include "job.hpp"
+
+#include "profile.hpp"
+
+// The system the calling thread belongs to, and its deque there.
+static thread_local JobSystem const* current_system = nullptr;
+static thread_local uint32_t         current_index  = 0;
+
+JobSystem::JobSystem(uint32_t n_threads)
+{
+    n_threads = max(1u, n_threads);
+    for (uint32_t i = 0; i < n_threads; i++)
+    {
+        queues.emplace_back(make_unique<Queue>());
+    }
+    for (uint32_t i = 1; i < n_threads; i++)
+    {
+        threads.emplace_back([this, i] { work(i); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        lock_guard lock { sleep_mutex };
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+uint32_t JobSystem::own_queue() const
+{
+    return current_system == this ? current_index : 0;
+}
+
+void JobSystem::run(function<void()> f, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->n.fetch_add(1, memory_order_relaxed);
+    push(Job { move(f), counter });
+}
+
+void JobSystem::push(Job&& job)
+{
+    Queue& queue = *queues[own_queue()];
+    {
+        lock_guard lock { queue.m };
+        queue.jobs.push_back(move(job));
+    }
+
+    // A thread going to sleep counts itself before it looks at n_queued, so one of the two sees the other.
+    n_queued.fetch_add(1);
+    if (n_sleeping.load() != 0)
+    {
+        {
+            lock_guard lock { sleep_mutex };
+        }
+        wake.notify_one();
+    }
+}
+
+void JobSystem::run_after(JobCounter& dependency, function<void()> f, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->n.fetch_add(1, memory_order_relaxed);
+
+    {
+        lock_guard lock { dependency.continuations_mutex };
+        if (dependency.n.load(memory_order_acquire) != 0)
+        {
+            dependency.continuations.push_back(JobCounter::Continuation { move(f), counter });
+            return;
+        }
+    }
+
+    push(Job { move(f), counter });
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    Job job {};
+    while (!counter.is_done())
+    {
+        if (take(job))
+            execute(job);
+        else
+            this_thread::yield();
+    }
+
+    // The last job may still be handing out the continuations.
+    lock_guard lock { counter.continuations_mutex };
+}
+
+size_t JobSystem::run_for(chrono::microseconds budget)
+{
+    using namespace std::chrono;
+
+    auto   start = steady_clock::now();
+    size_t n     = 0;
+    Job    job {};
+    while (take(job))
+    {
+        execute(job);
+        n++;
+        if (steady_clock::now() - start > budget)
+            break;
+    }
+    return n;
+}
+
+bool JobSystem::take(Job& job)
+{
+    if (n_queued.load(memory_order_relaxed) == 0)
+        return false;
+
+    auto n   = static_cast<uint32_t>(queues.size());
+    auto own = own_queue();
+    for (uint32_t k = 0; k < n; k++)
+    {
+        Queue&     queue = *queues[(own + k) % n];
+        lock_guard lock { queue.m };
+        if (queue.jobs.empty())
+            continue;
+
+        // The newest job of our own deque is the one most likely still in cache, the oldest of another deque is the one
+        // most likely to spawn more work.
+        if (k == 0)
+        {
+            job = move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        else
+        {
+            job = move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        n_queued.fetch_sub(1, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+    job.f();
+    job.f = nullptr;
+    if (job.counter != nullptr)
+        finish(*job.counter);
+}
+
+void JobSystem::finish(JobCounter& counter)
+{
+    vector<JobCounter::Continuation> continuations {};
+    {
+        // Counting down under the lock keeps run_after() from adding a continuation nobody will run.
+        lock_guard lock { counter.continuations_mutex };
+        if (counter.n.fetch_sub(1, memory_order_acq_rel) != 1)
+            return;
+        swap(continuations, counter.continuations);
+    }
+
+    for (auto& c : continuations)
+    {
+        push(Job { move(c.f), c.counter });
+    }
+}
+
+void JobSystem::work(uint32_t index)
+{
+    current_system = this;
+    current_index  = index;
+    PROFILE_THREAD("job " + to_string(index));
+
+    Job job {};
+    while (true)
+    {
+        if (take(job))
+        {
+            execute(job);
+            continue;
+        }
+
+        unique_lock lock { sleep_mutex };
+        n_sleeping.fetch_add(1);
+        wake.wait(lock, [&] { return stopping || n_queued.load() != 0; });
+        n_sleeping.fetch_sub(1);
+        if (stopping)
+            return;
+    }
+}
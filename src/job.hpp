@@ -0,0 +1,148 @@
+#ifndef JOB_HPP
+#define JOB_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util.hpp"
+
+using namespace std;
+
+class JobSystem;
+
+// Counts the jobs started with it that have not finished. Jobs can be made to wait for a counter to reach zero, see
+// JobSystem::run_after(). A counter can be reused once it reached zero, and must be waited on before it is destroyed.
+class JobCounter : private NonCopy<JobCounter>
+{
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        function<void()> f;
+        JobCounter*      counter;
+    };
+
+    atomic<uint32_t>     n { 0 };
+    mutex                continuations_mutex {};
+    vector<Continuation> continuations {};
+
+public:
+    JobCounter() = default;
+
+    [[nodiscard]] bool is_done() const
+    {
+        return n.load(memory_order_acquire) == 0;
+    }
+};
+
+/*
+ * Work stealing job system. Every thread of the pool has its own deque: it pushes and takes the newest jobs at the back,
+ * and when it runs out, it steals the oldest job of another deque. Threads outside of the pool (the main thread) push
+ * to a deque of their own, and take jobs from any deque while they wait on a counter or run_for() a time budget.
+ */
+class JobSystem : public Singleton<JobSystem>
+{
+private:
+    struct Job
+    {
+        function<void()> f;
+        JobCounter*      counter;
+    };
+
+    struct Queue
+    {
+        mutex      m {};
+        deque<Job> jobs {};
+    };
+
+    // queues[0] is the one of threads outside of the pool, queues[i] the one of threads[i - 1].
+    vector<unique_ptr<Queue>> queues {};
+    vector<thread>            threads {};
+
+    // Jobs pushed and not taken yet, and pool threads asleep until there are some.
+    atomic<uint32_t>   n_queued { 0 }, n_sleeping { 0 };
+    mutex              sleep_mutex {};
+    condition_variable wake {};
+    bool               stopping = false;
+
+public:
+    // n_threads counts the calling thread, which runs jobs while it waits. The pool has n_threads - 1 threads.
+    explicit JobSystem(uint32_t n_threads);
+
+    JobSystem() : JobSystem(max(1u, thread::hardware_concurrency()))
+    {
+    }
+
+    ~JobSystem();
+
+    [[nodiscard]] uint32_t size() const
+    {
+        return static_cast<uint32_t>(queues.size());
+    }
+
+    // Queues f, counting it in counter until it returns.
+    void run(function<void()> f, JobCounter* counter = nullptr);
+
+    // Queues f once dependency reaches zero. It is counted in counter from now on.
+    void run_after(JobCounter& dependency, function<void()> f, JobCounter* counter = nullptr);
+
+    // Runs jobs until counter reaches zero.
+    void wait(JobCounter& counter);
+
+    // Runs jobs until there are none left or budget is spent, returns how many ran. For the main thread, between frames.
+    size_t run_for(chrono::microseconds budget);
+
+    // Calls f(i) for every i in [0, n), in batches of batch_size taken in turn by the calling thread and up to
+    // max_threads - 1 jobs, and returns when all are done.
+    template<typename F>
+    void parallel_for(uint32_t n, uint32_t batch_size, uint32_t max_threads, F&& f)
+    {
+        uint32_t         n_batches = (n + batch_size - 1) / batch_size;
+        atomic<uint32_t> next { 0 };
+
+        auto worker = [&] {
+            for (uint32_t b = next++; b < n_batches; b = next++)
+            {
+                uint32_t end = min(n, (b + 1) * batch_size);
+                for (uint32_t i = b * batch_size; i < end; i++)
+                {
+                    f(i);
+                }
+            }
+        };
+
+        JobCounter counter {};
+        for (uint32_t t = 1; t < min({ max_threads, n_batches, size() }); t++)
+        {
+            run(worker, &counter);
+        }
+        worker();
+        wait(counter);
+    }
+
+private:
+    // The deque of the calling thread.
+    uint32_t own_queue() const;
+
+    // Takes the newest job of the calling thread's deque, or else the oldest job of another one.
+    bool take(Job& job);
+
+    // Queues a job already counted in its counter.
+    void push(Job&& job);
+
+    void execute(Job& job);
+
+    void finish(JobCounter& counter);
+
+    void work(uint32_t index);
+};
+
+#endif
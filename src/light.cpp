@@ -0,0 +1,405 @@
+#include <algorithm>
+
+#include "block_manager.hpp"
+#include "profile.hpp"
+
+/*
+ * Light:
+ *  sky light is LIGHT_MAX down from the sky until the first solid block, and block light LIGHT_MAX at emitting blocks.
+ *  Both lose a level per block they spread through, breadth first, except full sky light falling straight down. Solid
+ *  blocks stop light.
+ */
+
+template<uint8_t SHIFT>
+static uint8_t get_level(Chunk const& chunk, uint16_t i)
+{
+    return (chunk.get_light(i) >> SHIFT) & LIGHT_MAX;
+}
+
+template<uint8_t SHIFT>
+static void set_level(Chunk& chunk, uint16_t i, uint8_t level)
+{
+    auto other = static_cast<uint8_t>(chunk.get_light(i) & ~(LIGHT_MAX << SHIFT));
+    chunk.set_light(i, static_cast<uint8_t>(other | level << SHIFT));
+}
+
+// The level that light at level passes on to the block towards f.
+template<uint8_t SHIFT>
+static uint8_t spread_level(uint8_t level, uint8_t f)
+{
+    return SHIFT == SKY_LIGHT_SHIFT && f == FACE_BOTTOM && level == LIGHT_MAX ? LIGHT_MAX : level - 1;
+}
+
+// The block next to n towards f. Past the chunk's borders it is in outside(chunk, dx, dy), which may be nullptr.
+template<typename Outside>
+static LightNode neighbour(LightNode const& n, uint8_t f, Outside&& outside)
+{
+    uint16_t x = n.i >> 12u, y = (n.i >> 8u) & 0xfu, z = n.i & 0xffu;
+    switch (f)
+    {
+        case FACE_LEFT:
+            return x > 0 ? LightNode { n.chunk, static_cast<uint16_t>(n.i - 0x1000u), 0 }
+                         : LightNode { outside(n.chunk, -1, 0), static_cast<uint16_t>(n.i | 0xf000u), 0 };
+        case FACE_RIGHT:
+            return x < CHUNK_WIDTH - 1 ? LightNode { n.chunk, static_cast<uint16_t>(n.i + 0x1000u), 0 }
+                                       : LightNode { outside(n.chunk, 1, 0), static_cast<uint16_t>(n.i & 0x0fffu), 0 };
+        case FACE_FRONT:
+            return y > 0 ? LightNode { n.chunk, static_cast<uint16_t>(n.i - 0x100u), 0 }
+                         : LightNode { outside(n.chunk, 0, -1), static_cast<uint16_t>(n.i | 0x0f00u), 0 };
+        case FACE_BACK:
+            return y < CHUNK_WIDTH - 1 ? LightNode { n.chunk, static_cast<uint16_t>(n.i + 0x100u), 0 }
+                                       : LightNode { outside(n.chunk, 0, 1), static_cast<uint16_t>(n.i & 0xf0ffu), 0 };
+        case FACE_BOTTOM: return LightNode { z > 0 ? n.chunk : nullptr, static_cast<uint16_t>(n.i - 1u), 0 };
+        default: return LightNode { z < 255 ? n.chunk : nullptr, static_cast<uint16_t>(n.i + 1u), 0 };
+    }
+}
+
+// Spreads light from every block in queue, and from every block it brightens, then empties queue.
+template<uint8_t SHIFT, typename Outside, typename Mark>
+static void spread_light(vector<LightNode>& queue, Outside&& outside, Mark&& mark)
+{
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        LightNode n     = queue[head];
+        uint8_t   level = get_level<SHIFT>(*n.chunk, n.i);
+        if (level <= 1)
+        {
+            continue;
+        }
+
+        for (uint8_t f = 0; f < 6; f++)
+        {
+            LightNode m = neighbour(n, f, outside);
+            if (m.chunk == nullptr || m.chunk->at(m.i).is_solid())
+            {
+                continue;
+            }
+
+            uint8_t next = spread_level<SHIFT>(level, f);
+            if (get_level<SHIFT>(*m.chunk, m.i) < next)
+            {
+                set_level<SHIFT>(*m.chunk, m.i, next);
+                mark(m);
+                queue.push_back(m);
+            }
+        }
+    }
+    queue.clear();
+}
+
+// Darkens the blocks that got their light through the ones in removes (their level is the one they had), then empties
+// removes. The lit blocks met on the way have light of their own, they go to adds to spread it back in.
+template<uint8_t SHIFT, typename Outside, typename Mark>
+static void remove_light(vector<LightNode>& removes, vector<LightNode>& adds, Outside&& outside, Mark&& mark)
+{
+    for (size_t head = 0; head < removes.size(); head++)
+    {
+        LightNode n = removes[head];
+        for (uint8_t f = 0; f < 6; f++)
+        {
+            LightNode m = neighbour(n, f, outside);
+            if (m.chunk == nullptr)
+            {
+                continue;
+            }
+
+            uint8_t level = get_level<SHIFT>(*m.chunk, m.i);
+            if (level == 0)
+            {
+                continue;
+            }
+
+            bool from_n = level < n.level || (SHIFT == SKY_LIGHT_SHIFT && f == FACE_BOTTOM && level == LIGHT_MAX && n.level == LIGHT_MAX);
+            if (!from_n || (SHIFT == BLOCK_LIGHT_SHIFT && m.chunk->at(m.i).emission() != 0))
+            {
+                adds.push_back(m);
+                continue;
+            }
+
+            set_level<SHIFT>(*m.chunk, m.i, 0);
+            mark(m);
+            m.level = level;
+            removes.push_back(m);
+        }
+    }
+    removes.clear();
+}
+
+void Chunk::init_light()
+{
+    uint16_t top = 0, bottom = 256;
+    for (auto const& row : height_solid)
+    {
+        for (uint16_t h : row)
+        {
+            top    = max(top, h);
+            bottom = min(bottom, h);
+        }
+    }
+
+    // Everything above the highest solid block is in full sky light, and everything under the lowest one starts dark.
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        light_fill[s] = s * 16 >= top ? LIGHT_MAX << SKY_LIGHT_SHIFT : 0;
+        if (s * 16 >= top || (s + 1) * 16 <= bottom)
+        {
+            light[s].reset();
+            continue;
+        }
+
+        light[s]      = make_unique<LightSection>();
+        auto& section = *light[s];
+        for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+        {
+            for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+            {
+                auto     dark   = static_cast<uint16_t>(clamp(height_solid[x][y] - s * 16, 0, 16));
+                uint8_t* column = &section[x << 8u | y << 4u];
+                fill(column, column + dark, 0);
+                fill(column + dark, column + 16, LIGHT_MAX << SKY_LIGHT_SHIFT);
+            }
+        }
+    }
+
+    auto outside = [](Chunk*, int32_t, int32_t) -> Chunk* { return nullptr; };
+    auto mark    = [](LightNode const&) {};
+
+    // Sky light goes sideways from the lit part of each column into the columns next to it that are higher.
+    vector<LightNode> queue {};
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            uint16_t h  = height_solid[x][y];
+            uint16_t hn = h;
+            hn          = max<uint16_t>(hn, x > 0 ? height_solid[x - 1][y] : 0);
+            hn          = max<uint16_t>(hn, x < CHUNK_WIDTH - 1 ? height_solid[x + 1][y] : 0);
+            hn          = max<uint16_t>(hn, y > 0 ? height_solid[x][y - 1] : 0);
+            hn          = max<uint16_t>(hn, y < CHUNK_WIDTH - 1 ? height_solid[x][y + 1] : 0);
+            for (uint16_t z = h; z < hn; z++)
+            {
+                queue.push_back(LightNode { this, static_cast<uint16_t>(x << 12u | y << 8u | z), 0 });
+            }
+        }
+    }
+    spread_light<SKY_LIGHT_SHIFT>(queue, outside, mark);
+
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        if ((emitting_sections & (1u << s)) == 0)
+        {
+            continue;
+        }
+
+        for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+        {
+            for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+            {
+                for (uint16_t z = s * 16; z < s * 16 + 16; z++)
+                {
+                    if (uint8_t emission = blocks[x][y][z].emission(); emission != 0)
+                    {
+                        auto i = static_cast<uint16_t>(x << 12u | y << 8u | z);
+                        set_level<BLOCK_LIGHT_SHIFT>(*this, i, emission);
+                        queue.push_back(LightNode { this, i, 0 });
+                    }
+                }
+            }
+        }
+    }
+    spread_light<BLOCK_LIGHT_SHIFT>(queue, outside, mark);
+}
+
+Chunk* BlockManager::light_outside(Chunk* chunk, int32_t dx, int32_t dy)
+{
+    return get_chunk(chunk->chunk_id.add(dx, dy));
+}
+
+void BlockManager::light_seams(Chunk& chunk)
+{
+    constexpr int32_t sides[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+    for (auto const& d : sides)
+    {
+        Chunk* other = get_chunk(chunk.chunk_id.add(d[0], d[1]));
+        if (other == nullptr)
+        {
+            continue;
+        }
+
+        // Blocks on the border of chunk at a0 | z, the ones of other next to them at b0 | z.
+        auto     index = [](uint16_t x, uint16_t y) { return static_cast<uint16_t>(x << 12u | y << 8u); };
+        uint16_t edge = d[0] + d[1] < 0 ? 0 : CHUNK_WIDTH - 1, other_edge = CHUNK_WIDTH - 1 - edge;
+
+        for (uint16_t t = 0; t < CHUNK_WIDTH; t++)
+        {
+            uint16_t a0 = d[0] != 0 ? index(edge, t) : index(t, edge);
+            uint16_t b0 = d[0] != 0 ? index(other_edge, t) : index(t, other_edge);
+            for (uint16_t z = 0; z < 256; z++)
+            {
+                // Most sections of both are uniform with the same light, full sky light above the ground and none below.
+                if ((z & 0xfu) == 0 && chunk.is_light_uniform(z >> 4u) && other->is_light_uniform(z >> 4u) &&
+                    chunk.get_light(a0 | z) == other->get_light(b0 | z))
+                {
+                    z += 15;
+                    continue;
+                }
+
+                auto    a = static_cast<uint16_t>(a0 | z), b = static_cast<uint16_t>(b0 | z);
+                uint8_t la = chunk.get_light(a), lb = other->get_light(b);
+                if (la == lb)
+                {
+                    continue;
+                }
+
+                for (uint8_t c = 0; c < 2; c++)
+                {
+                    uint8_t shift = c == 0 ? SKY_LIGHT_SHIFT : BLOCK_LIGHT_SHIFT;
+                    uint8_t ca = (la >> shift) & LIGHT_MAX, cb = (lb >> shift) & LIGHT_MAX;
+                    if (ca > cb + 1)
+                        light_adds[c].push_back(LightNode { &chunk, a, 0 });
+                    else if (cb > ca + 1)
+                        light_adds[c].push_back(LightNode { other, b, 0 });
+                }
+            }
+        }
+    }
+}
+
+void BlockManager::queue_light(Chunk& chunk, uint16_t i, BlockData const& old)
+{
+    BlockData const& block = chunk.at(i);
+    LightNode        n { &chunk, i, 0 };
+    uint8_t          sky = get_level<SKY_LIGHT_SHIFT>(chunk, i), lamp = get_level<BLOCK_LIGHT_SHIFT>(chunk, i);
+
+    if (block.is_solid())
+    {
+        if (sky != 0)
+            light_removes[0].push_back(LightNode { &chunk, i, sky });
+        if (lamp != 0)
+            light_removes[1].push_back(LightNode { &chunk, i, lamp });
+        chunk.set_light(i, 0);
+        mark_light(n);
+    }
+    else
+    {
+        // Light comes in from the lit blocks around.
+        if (old.is_solid())
+        {
+            auto outside = [this](Chunk* c, int32_t dx, int32_t dy) { return light_outside(c, dx, dy); };
+            for (uint8_t f = 0; f < 6; f++)
+            {
+                LightNode m = neighbour(n, f, outside);
+                if (m.chunk == nullptr)
+                    continue;
+                if (get_level<SKY_LIGHT_SHIFT>(*m.chunk, m.i) > 1)
+                    light_adds[0].push_back(m);
+                if (get_level<BLOCK_LIGHT_SHIFT>(*m.chunk, m.i) > 1)
+                    light_adds[1].push_back(m);
+            }
+        }
+        if (old.emission() != 0 && lamp != 0)
+        {
+            light_removes[1].push_back(LightNode { &chunk, i, lamp });
+            set_level<BLOCK_LIGHT_SHIFT>(chunk, i, 0);
+            mark_light(n);
+        }
+    }
+
+    if (block.emission() != 0)
+    {
+        light_sources.push_back(n);
+    }
+}
+
+void BlockManager::queue_light(Chunk& chunk, uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, uint8_t z0, uint8_t z1)
+{
+    // All light in the box is taken out, the removal brings it back in from the blocks around.
+    for (uint16_t x = x0; x <= x1; x++)
+    {
+        for (uint16_t y = y0; y <= y1; y++)
+        {
+            for (uint16_t z = z0; z <= z1; z++)
+            {
+                auto    i     = static_cast<uint16_t>(x << 12u | y << 8u | z);
+                uint8_t light = chunk.get_light(i);
+                if (light != 0)
+                {
+                    uint8_t sky = (light >> SKY_LIGHT_SHIFT) & LIGHT_MAX, lamp = (light >> BLOCK_LIGHT_SHIFT) & LIGHT_MAX;
+                    if (sky != 0)
+                        light_removes[0].push_back(LightNode { &chunk, i, sky });
+                    if (lamp != 0)
+                        light_removes[1].push_back(LightNode { &chunk, i, lamp });
+                    chunk.set_light(i, 0);
+                    mark_light(LightNode { &chunk, i, 0 });
+                }
+                if (chunk.at(i).emission() != 0)
+                {
+                    light_sources.push_back(LightNode { &chunk, i, 0 });
+                }
+            }
+        }
+    }
+
+    // Blocks that were solid had no light to take out, they are lit from the blocks around the box.
+    auto outside = [this](Chunk* c, int32_t dx, int32_t dy) { return light_outside(c, dx, dy); };
+    auto shell   = [&](uint16_t x, uint16_t y, uint16_t z, uint8_t f) {
+        LightNode m = neighbour(LightNode { &chunk, static_cast<uint16_t>(x << 12u | y << 8u | z), 0 }, f, outside);
+        if (m.chunk == nullptr)
+            return;
+        if (get_level<SKY_LIGHT_SHIFT>(*m.chunk, m.i) > 1)
+            light_adds[0].push_back(m);
+        if (get_level<BLOCK_LIGHT_SHIFT>(*m.chunk, m.i) > 1)
+            light_adds[1].push_back(m);
+    };
+    for (uint16_t x = x0; x <= x1; x++)
+    {
+        for (uint16_t y = y0; y <= y1; y++)
+        {
+            shell(x, y, z0, FACE_BOTTOM);
+            shell(x, y, z1, FACE_TOP);
+        }
+        for (uint16_t z = z0; z <= z1; z++)
+        {
+            shell(x, y0, z, FACE_FRONT);
+            shell(x, y1, z, FACE_BACK);
+        }
+    }
+    for (uint16_t y = y0; y <= y1; y++)
+    {
+        for (uint16_t z = z0; z <= z1; z++)
+        {
+            shell(x0, y, z, FACE_LEFT);
+            shell(x1, y, z, FACE_RIGHT);
+        }
+    }
+}
+
+void BlockManager::update_light()
+{
+    PROFILE_ZONE("BlockManager::update_light");
+
+    auto outside = [this](Chunk* c, int32_t dx, int32_t dy) { return light_outside(c, dx, dy); };
+    auto mark    = [this](LightNode const& n) { mark_light(n); };
+
+    remove_light<SKY_LIGHT_SHIFT>(light_removes[0], light_adds[0], outside, mark);
+    remove_light<BLOCK_LIGHT_SHIFT>(light_removes[1], light_adds[1], outside, mark);
+
+    // Emitting blocks are lit after the removals, which would take their light out again.
+    for (LightNode const& n : light_sources)
+    {
+        uint8_t emission = n.chunk->at(n.i).emission();
+        if (emission > get_level<BLOCK_LIGHT_SHIFT>(*n.chunk, n.i))
+        {
+            set_level<BLOCK_LIGHT_SHIFT>(*n.chunk, n.i, emission);
+            mark_light(n);
+            light_adds[1].push_back(n);
+        }
+    }
+    light_sources.clear();
+
+    spread_light<SKY_LIGHT_SHIFT>(light_adds[0], outside, mark);
+    spread_light<BLOCK_LIGHT_SHIFT>(light_adds[1], outside, mark);
+
+    flush_dirty_chunks();
+}
@@ -1,12 +1,20 @@
+#include <chrono>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "db.hpp"
+#include "frame_pacer.hpp"
 #include "input.hpp"
+#include "job.hpp"
+#include "memory.hpp"
+#include "mesh_cache.hpp"
 #include "opengl.hpp"
 #include "player.hpp"
+#include "profile.hpp"
 #include "scene.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
@@ -15,9 +23,43 @@
 
 using namespace std;
 
+static void usage()
+{
+    cerr << "usage: craft [--record FILE | --replay FILE | --connect HOST[:PORT]]" << endl;
+    exit(1);
+}
 
-int main()
+int main(int argc, char** argv)
 {
+    PROFILE_THREAD("main");
+    Profiler::install_signal();
+
+    if (argc == 3 && string(argv[1]) == "--record")
+        InputStream::ins().record(argv[2]);
+    else if (argc == 3 && string(argv[1]) == "--replay")
+        InputStream::ins().replay(argv[2]);
+    else if (argc == 3 && string(argv[1]) == "--connect")
+    {
+        string   address = argv[2];
+        size_t   colon   = address.rfind(':');
+        uint16_t port    = SERVER_PORT;
+        if (colon != string::npos)
+        {
+            char const*   digits = argv[2] + colon + 1;
+            char*         end    = nullptr;
+            unsigned long v      = strtoul(digits, &end, 10);
+            if (end == digits || *end != '\0' || v == 0 || v > 65535)
+                usage();
+            port = static_cast<uint16_t>(v);
+        }
+        Scene::ins().connect(address.substr(0, colon), port);
+    }
+    else if (argc != 1)
+        usage();
+
+    // A client's world is the server's.
+    bool remote = Scene::ins().client != nullptr;
+
     if (glfwInit() == 0)
     {
         throw exception();
@@ -46,42 +88,132 @@ int main()
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetScrollCallback(window, scroll_callback);
 
-    glfwSwapInterval(1); // vsync
+    // A replay runs as fast as possible.
+    FramePacer::ins().set_mode(InputStream::ins().is_replaying() ? PresentMode::uncapped : PRESENT_MODE);
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    DB::ins().init();
-    ShaderManager::ins().init();
-    Scene::ins().init();
-    Player::ins().init();
-    UIManager::ins().init();
+    {
+        PROFILE_ZONE("startup");
+        if (!remote)
+            DB::ins().init();
+        // A replay meshes every chunk, a cache warmed by the last run would skew the times it compares.
+        if (!InputStream::ins().is_replaying())
+            MeshCache::ins().init();
+        ShaderManager::ins().init();
+        Player::ins().init();
+        UIManager::ins().init();
+    }
 
     Scene::ins().add_object(&Player::ins());
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.f);
 
-    while (glfwWindowShouldClose(window) == 0)
-    {
-        glfwPollEvents();
+    uint64_t last_memory_report = time_now_s();
+    uint64_t last_frame_report  = time_now_s();
 
-        Scene::ins().update();
-        Player::ins().update();
+    // A replay changes the range where the session did, not with its own frame times.
+    if (InputStream::ins().is_replaying())
+        Scene::ins().range_controller.enabled = false;
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        Scene::ins().render();
-        UIManager::ins().render();
+    while (glfwWindowShouldClose(window) == 0)
+    {
+        PROFILE_ZONE("frame");
 
-        glfwSwapBuffers(window);
+        FramePacer::ins().wait();
+        glfwPollEvents();
+        auto frame_start = chrono::steady_clock::now();
+
+        optional<float> del_t = InputStream::ins().next_frame(window);
+        if (!del_t.has_value())
+            break;
+
+        if (remote && !Scene::ins().client->is_open())
+        {
+            cerr << "Disconnected from the server" << endl;
+            break;
+        }
+
+        // A recording steps the world the way its replay will, the time budgets would cut it wherever this machine is slow.
+        Scene::ins().update(*del_t, InputStream::ins().is_recording() || InputStream::ins().is_replaying());
+        Player::ins().update(Scene::ins().block_manager);
+
+        auto update_time = chrono::steady_clock::now() - frame_start;
+        if (update_time < chrono::microseconds(UPDATE_BUDGET_US))
+        {
+            PROFILE_ZONE("JobSystem::run_for");
+            JobSystem::ins().run_for(chrono::microseconds(UPDATE_BUDGET_US) - chrono::duration_cast<chrono::microseconds>(update_time));
+        }
+
+        // The input that came in during the update turns the camera of this frame rather than of the next. Recorded after
+        // the frame's time step, a replay hands it over at the start of the next frame, before the world steps again, so
+        // the world goes through the same states.
+        if (!InputStream::ins().is_replaying())
+            glfwPollEvents();
+
+        {
+            PROFILE_ZONE("render");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            Scene::ins().render();
+            UIManager::ins().render();
+        }
+
+        // The frame's work without the wait for vsync.
+        float work_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - frame_start).count();
+
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+
+        FramePacer::ins().presented(InputStream::ins().take_input_time());
+        Scene::ins().adapt_range(work_ms, *del_t);
+
+        // F9 or SIGUSR1.
+        if (Profiler::ins().take_trace_request())
+        {
+            if (Profiler::ins().write_trace(TRACE_PATH))
+                cerr << "Trace written to " << TRACE_PATH << endl;
+            else
+                cerr << "Cannot write " << TRACE_PATH << endl;
+        }
+
+        if (MEMORY_REPORT_S != 0 && time_now_s() >= last_memory_report + MEMORY_REPORT_S)
+        {
+            Memory::ins().report(cerr);
+            last_memory_report = time_now_s();
+        }
+        if (FRAME_REPORT_S != 0 && time_now_s() >= last_frame_report + FRAME_REPORT_S)
+        {
+            FramePacer::ins().report(cerr);
+            last_frame_report = time_now_s();
+        }
     }
 
-    UIManager::ins().shutdown();
-    Player::ins().shutdown();
-    Scene::ins().shutdown();
-    DB::ins().shutdown();
+    {
+        PROFILE_ZONE("shutdown");
+        FramePacer::ins().shutdown();
+        UIManager::ins().shutdown();
+        Player::ins().shutdown();
+        Scene::ins().shutdown();
+        if (MeshCache::ins().is_enabled())
+            MeshCache::ins().report(cerr);
+        MeshCache::ins().shutdown();
+        // A replay leaves its db as recorded.
+        if (!remote && !InputStream::ins().is_replaying())
+            DB::ins().shutdown();
+        InputStream::ins().shutdown();
+    }
+    // The peaks of the whole replay, to compare builds.
+    if (InputStream::ins().is_replaying())
+        Memory::ins().report(cerr);
+    // A session profiled to the end keeps its shutdown.
+    if (Profiler::ins().is_enabled())
+        Profiler::ins().write_trace(TRACE_PATH);
 
     return 0;
 }
@@ -9,6 +9,7 @@
 namespace glmath = glm;
 
 using glmath::mat4;
+using glmath::vec2;
 using glmath::vec3;
 
 using glmath::cross;
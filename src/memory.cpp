@@ -0,0 +1,37 @@
+#include "memory.hpp"
+
+#include <cstdio>
+
+char const* Memory::name(MemoryCategory category)
+{
+    switch (category)
+    {
+        case MemoryCategory::chunks: return "chunks";
+        case MemoryCategory::light: return "light";
+        case MemoryCategory::snapshots: return "snapshots";
+        case MemoryCategory::meshes: return "meshes";
+        case MemoryCategory::db: return "db";
+        case MemoryCategory::textures: return "textures";
+        case MemoryCategory::gpu_buffers: return "gpu buffers";
+        case MemoryCategory::gpu_textures: return "gpu textures";
+        default: return "";
+    }
+}
+
+void Memory::report(ostream& out) const
+{
+    auto mib = [](int64_t bytes) { return static_cast<double>(bytes) / (1024. * 1024.); };
+
+    char    line[96];
+    int64_t cpu = 0, gpu = 0;
+    out << "Memory (MiB, now / peak):\n";
+    for (size_t c = 0; c < counters.size(); c++)
+    {
+        auto category = static_cast<MemoryCategory>(c);
+        snprintf(line, sizeof(line), "  %-14s %9.2f / %9.2f\n", name(category), mib(bytes(category)), mib(peak(category)));
+        out << line;
+        (category >= MemoryCategory::gpu_buffers ? gpu : cpu) += bytes(category);
+    }
+    snprintf(line, sizeof(line), "  %-14s %9.2f\n  %-14s %9.2f\n", "cpu total", mib(cpu), "gpu total", mib(gpu));
+    out << line << flush;
+}
@@ -0,0 +1,146 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "util.hpp"
+
+using namespace std;
+
+enum class MemoryCategory : uint8_t
+{
+    chunks,       // Chunk, blocks and heightmaps
+    light,        // light sections of chunks
+    snapshots,    // block sections copied by Chunk::snapshot
+    meshes,       // CPU vertices, until the renderer uploads them
+    db,           // DB::chunks and DB::baked buffers
+    textures,     // decoded images, while they are uploaded
+    gpu_buffers,  // glBufferData
+    gpu_textures, // texture storage
+
+    count,
+};
+
+/*
+ * Bytes in use and high-water mark of each category. Any thread can count, and read the counts at any time.
+ */
+class Memory : public Singleton<Memory>
+{
+private:
+    struct Counter
+    {
+        atomic<int64_t> bytes { 0 }, peak { 0 };
+    };
+
+    array<Counter, static_cast<size_t>(MemoryCategory::count)> counters {};
+
+public:
+    // bytes is negative for a release.
+    void add(MemoryCategory category, int64_t bytes)
+    {
+        Counter& counter = counters[static_cast<size_t>(category)];
+        int64_t  now     = counter.bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+        int64_t  peak    = counter.peak.load(memory_order_relaxed);
+        while (now > peak && !counter.peak.compare_exchange_weak(peak, now, memory_order_relaxed))
+        {
+        }
+    }
+
+    [[nodiscard]] int64_t bytes(MemoryCategory category) const
+    {
+        return counters[static_cast<size_t>(category)].bytes.load(memory_order_relaxed);
+    }
+
+    [[nodiscard]] int64_t peak(MemoryCategory category) const
+    {
+        return counters[static_cast<size_t>(category)].peak.load(memory_order_relaxed);
+    }
+
+    // All categories, CPU and GPU.
+    [[nodiscard]] int64_t total() const
+    {
+        int64_t sum = 0;
+        for (Counter const& counter : counters)
+        {
+            sum += counter.bytes.load(memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    static char const* name(MemoryCategory category);
+
+    // One line per category, in MiB, and the totals of the CPU and the GPU.
+    void report(ostream& out) const;
+};
+
+// A T counted in category for as long as it exists.
+template<typename T, MemoryCategory category>
+struct Tracked : T
+{
+    Tracked() : T()
+    {
+        Memory::ins().add(category, sizeof(T));
+    }
+
+    Tracked(Tracked const& o) : T(o)
+    {
+        Memory::ins().add(category, sizeof(T));
+    }
+
+    ~Tracked()
+    {
+        Memory::ins().add(category, -static_cast<int64_t>(sizeof(T)));
+    }
+
+    Tracked& operator=(Tracked const&) = default;
+};
+
+// Allocator for containers counted in category.
+template<typename T, MemoryCategory category>
+struct TrackedAllocator
+{
+    using value_type = T;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = TrackedAllocator<U, category>;
+    };
+
+    TrackedAllocator() = default;
+
+    template<typename U>
+    TrackedAllocator(TrackedAllocator<U, category> const&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        Memory::ins().add(category, static_cast<int64_t>(n * sizeof(T)));
+        return allocator<T> {}.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        Memory::ins().add(category, -static_cast<int64_t>(n * sizeof(T)));
+        allocator<T> {}.deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(TrackedAllocator<U, category> const&) const noexcept
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(TrackedAllocator<U, category> const&) const noexcept
+    {
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,375 @@
+#include "mesh_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "profile.hpp"
+
+// "craftmsh", followed by the version of the file format. What the meshes are built by is part of their key, see
+// Chunk::mesh_key().
+constexpr uint64_t MESH_MAGIC   = 0x6873'6d74'6661'7263;
+constexpr uint64_t MESH_VERSION = 1;
+
+struct MeshHeader
+{
+    uint64_t magic;
+    uint64_t version;
+    uint64_t key;
+    uint64_t count; // vertices
+};
+
+static int64_t file_time_now()
+{
+    return filesystem::file_time_type::clock::now().time_since_epoch().count();
+}
+
+static uint64_t file_bytes(uint64_t count)
+{
+    return sizeof(MeshHeader) + count * sizeof(BlockVertex);
+}
+
+MeshCache::~MeshCache()
+{
+    shutdown();
+}
+
+void MeshCache::init(string const& dir)
+{
+    PROFILE_ZONE("MeshCache::init");
+    shutdown();
+
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if (ec)
+    {
+        cerr << "Cannot create " << dir << ", meshes are not cached" << endl;
+        return;
+    }
+
+    lock_guard lock { entries_mutex };
+    path = dir;
+    entries.clear();
+    total_bytes = 0;
+    for (auto const& file : filesystem::directory_iterator(dir, ec))
+    {
+        // Files left by a write cut short, and any that are not whole meshes, are dropped.
+        int32_t    x = 0, y = 0;
+        MeshHeader header {};
+        ifstream   in { file.path(), ios::binary };
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        uint64_t bytes   = file.file_size(ec);
+        bool     is_mesh = sscanf(file.path().filename().string().c_str(), "%d_%d.mesh", &x, &y) == 2 && in && !ec &&
+                       header.magic == MESH_MAGIC && header.version == MESH_VERSION &&
+                       header.count <= (bytes - sizeof(header)) / sizeof(BlockVertex) && bytes == file_bytes(header.count);
+        in.close();
+
+        ChunkID chunk_id { x, y };
+        if (!is_mesh || file_path(chunk_id) != file.path().string())
+        {
+            filesystem::remove(file.path(), ec);
+            continue;
+        }
+
+        entries[chunk_id] = Entry { header.key, bytes, file.last_write_time(ec).time_since_epoch().count() };
+        total_bytes += bytes;
+    }
+    evict();
+
+    hits     = 0;
+    misses   = 0;
+    stopping = false;
+    io       = thread([this] { work(); });
+    enabled  = true;
+}
+
+void MeshCache::prefetch(ChunkID const& chunk_id)
+{
+    if (!is_enabled())
+        return;
+
+    lock_guard lock { entries_mutex };
+    if (entries.count(chunk_id) == 0 || prefetched.count(chunk_id) != 0)
+        return;
+    prefetched.emplace(chunk_id, Mesh {});
+    reads.push_back(chunk_id);
+    wake.notify_one();
+}
+
+bool MeshCache::take(ChunkID const& chunk_id, uint64_t key, BlockVertices& out)
+{
+    lock_guard lock { entries_mutex };
+
+    auto it  = prefetched.find(chunk_id);
+    bool hit = it != prefetched.end() && it->second.ready && it->second.key == key;
+    if (hit)
+    {
+        out = move(it->second.vertices);
+
+        // The modification time is the eviction order.
+        auto entry = entries.find(chunk_id);
+        if (entry != entries.end())
+            entry->second.used = file_time_now();
+        touches.push_back(chunk_id);
+        wake.notify_one();
+    }
+    else
+    {
+        // Stored since the chunk was built, and not written yet.
+        auto write = writes.find(chunk_id);
+        if (write != writes.end() && write->second.key == key)
+        {
+            out = write->second.vertices;
+            hit = true;
+        }
+    }
+    if (it != prefetched.end())
+        prefetched.erase(it);
+
+    (hit ? hits : misses).fetch_add(1, memory_order_relaxed);
+    return hit;
+}
+
+void MeshCache::discard(ChunkID const& chunk_id)
+{
+    if (!is_enabled())
+        return;
+
+    lock_guard lock { entries_mutex };
+    prefetched.erase(chunk_id);
+}
+
+void MeshCache::store(ChunkID const& chunk_id, uint64_t key, BlockVertices const& vertices)
+{
+    PROFILE_ZONE("MeshCache::store");
+
+    Mesh mesh { true, key, vertices };
+
+    lock_guard lock { entries_mutex };
+    auto       it       = writes.find(chunk_id);
+    uint64_t   replaced = it == writes.end() ? 0 : it->second.vertices.size() * sizeof(BlockVertex);
+    uint64_t   bytes    = vertices.size() * sizeof(BlockVertex);
+    if (pending_bytes - replaced + bytes > MAX_PENDING_BYTES)
+    {
+        // The disk is behind, the chunk is meshed again next time.
+        return;
+    }
+    writes[chunk_id] = move(mesh);
+    pending_bytes    = pending_bytes - replaced + bytes;
+    wake.notify_one();
+}
+
+void MeshCache::work()
+{
+    Profiler::ins().set_thread_name("mesh cache");
+
+    unique_lock lock { entries_mutex };
+    while (true)
+    {
+        wake.wait(lock, [&] { return stopping || !reads.empty() || !writes.empty() || !touches.empty(); });
+        if (stopping)
+            reads.clear();
+
+        if (!reads.empty())
+        {
+            ChunkID chunk_id = reads.front();
+            reads.pop_front();
+            auto entry = entries.find(chunk_id);
+            if (prefetched.count(chunk_id) == 0 || entry == entries.end())
+            {
+                prefetched.erase(chunk_id);
+                continue;
+            }
+
+            uint64_t key = entry->second.key;
+            Mesh     mesh {};
+            lock.unlock();
+            bool ok = read(chunk_id, key, mesh);
+            lock.lock();
+
+            // The file may have been rewritten meanwhile, it is only dropped if it still holds what was read.
+            entry = entries.find(chunk_id);
+            if (!ok && entry != entries.end() && entry->second.key == key)
+            {
+                total_bytes -= entry->second.bytes;
+                entries.erase(entry);
+            }
+            auto it = prefetched.find(chunk_id);
+            if (it != prefetched.end() && !it->second.ready)
+            {
+                if (ok)
+                    it->second = move(mesh);
+                else
+                    prefetched.erase(it);
+            }
+            continue;
+        }
+
+        if (!writes.empty())
+        {
+            auto node = writes.extract(writes.begin());
+            pending_bytes -= node.mapped().vertices.size() * sizeof(BlockVertex);
+            lock.unlock();
+            bool ok = write(node.key(), node.mapped());
+            lock.lock();
+
+            if (ok)
+            {
+                uint64_t bytes = file_bytes(node.mapped().vertices.size());
+                auto [it, inserted] = entries.try_emplace(node.key(), Entry { 0, 0, 0 });
+                total_bytes += bytes - it->second.bytes;
+                it->second = Entry { node.mapped().key, bytes, file_time_now() };
+                evict();
+            }
+            continue;
+        }
+
+        if (!touches.empty())
+        {
+            string p = file_path(touches.front());
+            touches.pop_front();
+            lock.unlock();
+            error_code ec;
+            filesystem::last_write_time(p, filesystem::file_time_type::clock::now(), ec);
+            lock.lock();
+            continue;
+        }
+
+        if (stopping)
+            return;
+    }
+}
+
+bool MeshCache::read(ChunkID const& chunk_id, uint64_t key, Mesh& mesh) const
+{
+    PROFILE_ZONE("MeshCache::read");
+
+    string     p = file_path(chunk_id);
+    error_code ec;
+    uint64_t   bytes = filesystem::file_size(p, ec);
+    ifstream   in { p, ios::binary };
+    MeshHeader header {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (ec || !in || header.magic != MESH_MAGIC || header.version != MESH_VERSION || header.key != key ||
+        header.count > (bytes - sizeof(header)) / sizeof(BlockVertex) || bytes != file_bytes(header.count))
+    {
+        return false;
+    }
+
+    mesh.vertices.resize(header.count);
+    in.read(reinterpret_cast<char*>(mesh.vertices.data()), static_cast<streamsize>(sizeof(BlockVertex) * header.count));
+    mesh.ready = true;
+    mesh.key   = key;
+    return static_cast<bool>(in);
+}
+
+bool MeshCache::write(ChunkID const& chunk_id, Mesh const& mesh) const
+{
+    PROFILE_ZONE("MeshCache::write");
+
+    // Written aside and renamed over the old file, a crash leaves either whole.
+    string     p = file_path(chunk_id), tmp = p + ".tmp";
+    MeshHeader header { MESH_MAGIC, MESH_VERSION, mesh.key, mesh.vertices.size() };
+    error_code ec;
+    {
+        ofstream out { tmp, ios::binary | ios::trunc };
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const*>(mesh.vertices.data()), static_cast<streamsize>(sizeof(BlockVertex) * mesh.vertices.size()));
+        if (!out)
+        {
+            out.close();
+            filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+
+    filesystem::rename(tmp, p, ec);
+    if (ec)
+    {
+        filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::evict()
+{
+    uint64_t budget = MESH_CACHE_MIB * 1024 * 1024;
+    if (total_bytes <= budget)
+    {
+        return;
+    }
+
+    PROFILE_ZONE("MeshCache::evict");
+
+    vector<pair<int64_t, ChunkID>> by_use {};
+    for (auto const& [chunk_id, entry] : entries)
+    {
+        by_use.emplace_back(entry.used, chunk_id);
+    }
+    sort(by_use.begin(), by_use.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    // Down to 7/8 of the budget, the next writes do not evict again right away.
+    for (auto const& [used, chunk_id] : by_use)
+    {
+        if (total_bytes <= budget / 8 * 7)
+            break;
+        error_code ec;
+        filesystem::remove(file_path(chunk_id), ec);
+        total_bytes -= entries[chunk_id].bytes;
+        entries.erase(chunk_id);
+    }
+}
+
+void MeshCache::report(ostream& out) const
+{
+    uint64_t h = get_hits(), m = get_misses();
+    size_t   n_files;
+    uint64_t bytes;
+    {
+        lock_guard lock { entries_mutex };
+        n_files = entries.size();
+        bytes   = total_bytes;
+    }
+
+    char line[128];
+    snprintf(line,
+             sizeof(line),
+             "Mesh cache: %llu hits, %llu misses (%.1f%% hit), %.1f MiB in %zu files\n",
+             static_cast<unsigned long long>(h),
+             static_cast<unsigned long long>(m),
+             h + m == 0 ? 0. : 100. * static_cast<double>(h) / static_cast<double>(h + m),
+             static_cast<double>(bytes) / (1024. * 1024.),
+             n_files);
+    out << line << flush;
+}
+
+void MeshCache::shutdown()
+{
+    enabled = false;
+    {
+        lock_guard lock { entries_mutex };
+        stopping = true;
+    }
+    wake.notify_all();
+    if (io.joinable())
+        io.join();
+
+    lock_guard lock { entries_mutex };
+    entries.clear();
+    total_bytes = 0;
+    reads.clear();
+    prefetched.clear();
+    writes.clear();
+    pending_bytes = 0;
+    touches.clear();
+}
+
+string MeshCache::file_path(ChunkID const& chunk_id) const
+{
+    auto name = to_string(static_cast<int32_t>(chunk_id.x)) + "_" + to_string(static_cast<int32_t>(chunk_id.y)) + ".mesh";
+    return (filesystem::path(path) / name).string();
+}
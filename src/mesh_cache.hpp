@@ -0,0 +1,131 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "block.hpp"
+#include "chunk.hpp"
+#include "config.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * Chunk meshes kept on disk between sessions, one file per chunk holding the mesh last built for it and the key of what it
+ * was built from, see Chunk::mesh_key(). A chunk whose blocks and light, and those of its neighbours' border columns, are
+ * the same as when its mesh was stored gets the stored vertices instead of being meshed again. The files take up to
+ * MESH_CACHE_MIB, the least recently used are deleted first. The directory is the index, a file's modification time is
+ * when it was last used.
+ *
+ * Meshing never waits on the disk: a thread of the cache reads the mesh of a chunk when the chunk is built, ahead of its
+ * meshing, and writes the meshes stored since. A mesh not read yet when its chunk is meshed is a miss.
+ *
+ * Off until init(). Any thread can call it.
+ */
+class MeshCache : public Singleton<MeshCache>
+{
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t bytes;
+        int64_t  used; // file time ticks
+    };
+
+    // A mesh read ahead of its chunk's meshing, or waiting to be written.
+    struct Mesh
+    {
+        bool          ready = false;
+        uint64_t      key   = 0;
+        BlockVertices vertices {};
+    };
+
+    // Meshes waiting to be written take up to this much memory, further stores are dropped.
+    static constexpr uint64_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+    string             path {};
+    atomic<bool>       enabled { false };
+    thread             io {};
+    bool               stopping = false;
+    condition_variable wake {};
+
+    // Guards all below. The files are only read and written by io, without it.
+    mutable mutex                                  entries_mutex {};
+    unordered_map<ChunkID, Entry, ChunkID::Hasher> entries {};
+    uint64_t                                       total_bytes = 0;
+
+    // Reads asked for in order, and the meshes of the chunks that asked, ready once read. A chunk meshed or gone before
+    // its read drops its mesh, the read is then skipped.
+    deque<ChunkID>                                reads {};
+    unordered_map<ChunkID, Mesh, ChunkID::Hasher> prefetched {};
+
+    // Meshes to write, the last one stored for each chunk, and files to mark as used.
+    unordered_map<ChunkID, Mesh, ChunkID::Hasher> writes {};
+    uint64_t                                      pending_bytes = 0;
+    deque<ChunkID>                                touches {};
+
+    atomic<uint64_t> hits { 0 }, misses { 0 };
+
+public:
+    ~MeshCache();
+
+    // Opens the cache in the directory at path, creating it if needed, and starts its thread.
+    void init(string const& dir = MESH_CACHE_PATH);
+
+    [[nodiscard]] bool is_enabled() const
+    {
+        return enabled.load(memory_order_relaxed);
+    }
+
+    // Starts reading the mesh stored for chunk_id, for a take() once the chunk is meshed.
+    void prefetch(ChunkID const& chunk_id);
+
+    // Moves the mesh read for chunk_id into out if it was built from key. Counts a hit or a miss.
+    bool take(ChunkID const& chunk_id, uint64_t key, BlockVertices& out);
+
+    // Drops what was read for a chunk that is unloaded.
+    void discard(ChunkID const& chunk_id);
+
+    // Queues vertices to be written as the mesh of chunk_id built from key.
+    void store(ChunkID const& chunk_id, uint64_t key, BlockVertices const& vertices);
+
+    // Hits and misses since init(), and the size on disk.
+    void report(ostream& out) const;
+
+    [[nodiscard]] uint64_t get_hits() const
+    {
+        return hits.load(memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t get_misses() const
+    {
+        return misses.load(memory_order_relaxed);
+    }
+
+    // Writes what is queued and turns the cache off, leaving its files.
+    void shutdown();
+
+private:
+    [[nodiscard]] string file_path(ChunkID const& chunk_id) const;
+
+    // Runs on io until shutdown(): reads first, they are waited on, then writes and touches.
+    void work();
+
+    // Reads the file of chunk_id into mesh. Returns false if it is missing, broken or not of key.
+    bool read(ChunkID const& chunk_id, uint64_t key, Mesh& mesh) const;
+
+    bool write(ChunkID const& chunk_id, Mesh const& mesh) const;
+
+    // Deletes the least recently used files until the rest fit in MESH_CACHE_MIB. Called with entries_mutex held.
+    void evict();
+};
+
+#endif
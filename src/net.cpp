@@ -0,0 +1,461 @@
+#include "net.hpp"
+
+#include <array>
+#include <exception>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "block_manager.hpp"
+
+#ifdef _WIN32
+using socket_len = int;
+
+static void close_socket(intptr_t fd)
+{
+    closesocket(static_cast<SOCKET>(fd));
+}
+
+static bool would_block()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+static void set_non_blocking(intptr_t fd)
+{
+    u_long on = 1;
+    ioctlsocket(static_cast<SOCKET>(fd), FIONBIO, &on);
+}
+
+static void init_sockets()
+{
+    static bool done = false;
+    if (!done)
+    {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+        done = true;
+    }
+}
+#else
+using socket_len = socklen_t;
+
+static void close_socket(intptr_t fd)
+{
+    ::close(static_cast<int>(fd));
+}
+
+static bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void set_non_blocking(intptr_t fd)
+{
+    fcntl(static_cast<int>(fd), F_SETFL, fcntl(static_cast<int>(fd), F_GETFL) | O_NONBLOCK);
+}
+
+static void init_sockets()
+{
+}
+#endif
+
+// Sends go out as they are queued, small moves and edits should not wait for more. A peer gone in the middle of a send
+// closes the connection instead of raising SIGPIPE.
+static void set_options(intptr_t fd)
+{
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const*>(&on), sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<char const*>(&on), sizeof(on));
+#endif
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+void encode_chunk(NetWriter& w, ChunkSnapshot const& snapshot)
+{
+    w.chunk_id(snapshot.chunk_id);
+
+    array<BlockData, 256> column {}, last {};
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            for (uint16_t s = 0; s < 16; s++)
+            {
+                auto const& section = snapshot.sections[s];
+                if (section == nullptr)
+                    fill_n(&column[s * 16], 16, BlockData {});
+                else
+                    copy_n(&(*section)[x << 8u | y << 4u], 16, &column[s * 16]);
+            }
+
+            if ((x != 0 || y != 0) && column == last)
+            {
+                w.varint(0);
+                continue;
+            }
+            last = column;
+
+            uint32_t n_runs = 1;
+            for (uint32_t z = 1; z < 256; z++)
+            {
+                n_runs += column[z] != column[z - 1];
+            }
+            w.varint(n_runs);
+            uint32_t z0 = 0;
+            for (uint32_t z = 1; z <= 256; z++)
+            {
+                if (z == 256 || column[z] != column[z0])
+                {
+                    w.block(column[z0]);
+                    w.varint(z - z0);
+                    z0 = z;
+                }
+            }
+        }
+    }
+}
+
+bool decode_chunk(NetReader& r, ChunkSnapshot& snapshot)
+{
+    snapshot.chunk_id = r.chunk_id();
+
+    array<unique_ptr<BlockSection>, 16> sections {};
+    array<BlockData, 256>               column {};
+    for (uint16_t x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (uint16_t y = 0; y < CHUNK_WIDTH; y++)
+        {
+            uint64_t n_runs = r.varint();
+            if (n_runs == 0 && (x != 0 || y != 0))
+            {
+                // The same as the column before.
+            }
+            else
+            {
+                uint32_t z = 0;
+                for (uint64_t i = 0; i < n_runs && r.ok; i++)
+                {
+                    BlockData block = r.block();
+                    uint64_t  n     = r.varint();
+                    if (n == 0 || z + n > 256)
+                        return r.ok = false;
+                    fill_n(&column[z], n, block);
+                    z += static_cast<uint32_t>(n);
+                }
+                if (z != 256)
+                    return r.ok = false;
+            }
+
+            for (uint16_t s = 0; s < 16; s++)
+            {
+                auto& section = sections[s];
+                if (section == nullptr)
+                {
+                    if (all_of(&column[s * 16], &column[s * 16 + 16], [](BlockData const& b) { return b.is_null(); }))
+                        continue;
+                    section = make_unique<BlockSection>();
+                }
+                copy_n(&column[s * 16], 16, &(*section)[x << 8u | y << 4u]);
+            }
+        }
+    }
+
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        snapshot.sections[s] = move(sections[s]);
+    }
+    return r.ok;
+}
+
+size_t encode_delta(NetWriter& w, ChunkSnapshot const& from, ChunkSnapshot const& to)
+{
+    vector<pair<uint16_t, BlockData>> changed {};
+    for (uint16_t s = 0; s < 16; s++)
+    {
+        auto const& a = from.sections[s];
+        auto const& b = to.sections[s];
+        if (a == b)
+            continue;
+
+        for (uint16_t i = 0; i < CHUNK_WIDTH * CHUNK_WIDTH * 16; i++)
+        {
+            BlockData old   = a == nullptr ? BlockData {} : (*a)[i];
+            BlockData block = b == nullptr ? BlockData {} : (*b)[i];
+            if (old != block)
+                changed.emplace_back(static_cast<uint16_t>(s << 12u | i), block);
+        }
+    }
+
+    w.chunk_id(to.chunk_id);
+    w.varint(changed.size());
+    uint16_t last = 0;
+    for (auto const& [i, block] : changed)
+    {
+        w.varint(i - last);
+        w.block(block);
+        last = i;
+    }
+    return changed.size();
+}
+
+Connection::Connection(intptr_t fd) : fd(fd)
+{
+    set_non_blocking(fd);
+    set_options(fd);
+}
+
+Connection::~Connection()
+{
+    close();
+}
+
+unique_ptr<Connection> Connection::connect(string const& host, uint16_t port)
+{
+    init_sockets();
+
+    addrinfo hints {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* info    = nullptr;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &info) != 0)
+    {
+        cerr << "Cannot resolve " << host << endl;
+        throw exception();
+    }
+
+    intptr_t fd = -1;
+    for (addrinfo* a = info; a != nullptr && fd < 0; a = a->ai_next)
+    {
+        fd = static_cast<intptr_t>(socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+        if (fd >= 0 && ::connect(fd, a->ai_addr, static_cast<socket_len>(a->ai_addrlen)) != 0)
+        {
+            close_socket(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(info);
+
+    if (fd < 0)
+    {
+        cerr << "Cannot connect to " << host << ":" << port << endl;
+        throw exception();
+    }
+    return make_unique<Connection>(fd);
+}
+
+void Connection::send(NetMessage type, NetWriter& w)
+{
+    if (!is_open())
+    {
+        w.data.clear();
+        return;
+    }
+
+    NetWriter header {};
+    header.varint(w.data.size() + 1);
+    out.insert(out.end(), header.data.begin(), header.data.end());
+    out.push_back(static_cast<uint8_t>(type));
+    out.insert(out.end(), w.data.begin(), w.data.end());
+    w.data.clear();
+}
+
+void Connection::flush()
+{
+    while (is_open() && pending() > 0)
+    {
+        auto n = ::send(fd, reinterpret_cast<char const*>(out.data() + out_sent), static_cast<int>(pending()), SEND_FLAGS);
+        if (n < 0)
+        {
+            if (!would_block())
+                close();
+            break;
+        }
+        out_sent += static_cast<size_t>(n);
+        bytes_sent += static_cast<uint64_t>(n);
+    }
+
+    // What was sent is dropped once it is most of the buffer, rather than moving the rest on every call.
+    if (out_sent == out.size() || out_sent > out.size() / 2)
+    {
+        out.erase(out.begin(), out.begin() + static_cast<ptrdiff_t>(out_sent));
+        out_sent = 0;
+    }
+}
+
+bool Connection::read()
+{
+    // Up to a whole message past what receive() parses, the rest waits in the socket for the next call.
+    array<uint8_t, 64 * 1024> buffer;
+    while (is_open() && in.size() <= MAX_MESSAGE_SIZE + MAX_HEADER_SIZE)
+    {
+        auto n = ::recv(fd, reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0);
+        if (n > 0)
+        {
+            in.insert(in.end(), buffer.begin(), buffer.begin() + n);
+            bytes_received += static_cast<uint64_t>(n);
+            continue;
+        }
+        if (n < 0 && would_block())
+            break;
+        close();
+    }
+    return is_open() || !in.empty();
+}
+
+void Connection::close()
+{
+    if (fd >= 0)
+    {
+        close_socket(fd);
+        fd = -1;
+    }
+}
+
+Listener::Listener(uint16_t port)
+{
+    init_sockets();
+
+    fd = static_cast<intptr_t>(socket(AF_INET, SOCK_STREAM, 0));
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&on), sizeof(on));
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0)
+    {
+        cerr << "Cannot listen on port " << port << endl;
+        throw exception();
+    }
+    set_non_blocking(fd);
+}
+
+Listener::~Listener()
+{
+    close_socket(fd);
+}
+
+unique_ptr<Connection> Listener::accept()
+{
+    auto client = static_cast<intptr_t>(::accept(fd, nullptr, nullptr));
+    if (client < 0)
+        return nullptr;
+    return make_unique<Connection>(client);
+}
+
+NetClient::NetClient(string const& host, uint16_t port) : connection(Connection::connect(host, port))
+{
+    NetWriter w {};
+    connection->send(NetMessage::hello, w);
+    connection->flush();
+}
+
+void NetClient::send_move(vec3 const& pos, vec3 const& forward, vec3 const& velocity, int32_t range)
+{
+    NetWriter w {};
+    w.vec(pos);
+    w.vec(forward);
+    w.vec(velocity);
+    w.varint(static_cast<uint64_t>(range));
+    connection->send(NetMessage::move, w);
+    connection->flush();
+}
+
+void NetClient::send_add_block(BlockID const& block_id, BlockData const& block)
+{
+    NetWriter w {};
+    w.block_id(block_id);
+    w.block(block);
+    connection->send(NetMessage::add_block, w);
+    connection->flush();
+}
+
+void NetClient::send_del_block(BlockID const& block_id)
+{
+    NetWriter w {};
+    w.block_id(block_id);
+    connection->send(NetMessage::del_block, w);
+    connection->flush();
+}
+
+void NetClient::receive(BlockManager* block_manager)
+{
+    connection->receive([&](NetMessage type, NetReader& r) {
+        switch (type)
+        {
+            case NetMessage::welcome: id = static_cast<uint32_t>(r.varint()); break;
+            case NetMessage::chunk:
+            {
+                ChunkSnapshot snapshot {};
+                if (decode_chunk(r, snapshot) && block_manager != nullptr)
+                    block_manager->insert_chunk(new Chunk(snapshot));
+                n_chunks++;
+                break;
+            }
+            case NetMessage::chunk_delta:
+            {
+                ChunkID  chunk_id = r.chunk_id();
+                uint64_t n        = r.varint();
+                uint64_t i        = 0;
+
+                // A delta for a chunk the client no longer has is dropped, add_block() would generate it here instead
+                // of waiting for the server's.
+                bool loaded = block_manager != nullptr && block_manager->get_chunk(chunk_id) != nullptr;
+                for (uint64_t k = 0; k < n && r.ok; k++)
+                {
+                    i += r.varint();
+                    BlockData block = r.block();
+                    if (i >= 1u << 16u)
+                        r.ok = false;
+                    if (!r.ok || !loaded)
+                        continue;
+
+                    auto    s = static_cast<uint32_t>(i >> 12u), j = static_cast<uint32_t>(i & 0xfffu);
+                    BlockID block_id { static_cast<int32_t>(chunk_id.x + (j >> 8u)),
+                                       static_cast<int32_t>(chunk_id.y + ((j >> 4u) & 0xfu)),
+                                       static_cast<uint8_t>(s * 16 + (j & 0xfu)) };
+                    if (block.is_null())
+                        block_manager->del_block(block_id);
+                    else
+                        block_manager->add_block(block_id, BlockData { block });
+                }
+                n_deltas++;
+                break;
+            }
+            case NetMessage::unload:
+            {
+                ChunkID chunk_id = r.chunk_id();
+                if (block_manager != nullptr)
+                    block_manager->remove_chunk(chunk_id);
+                break;
+            }
+            case NetMessage::stats:
+                stats.n_clients    = static_cast<uint32_t>(r.varint());
+                stats.tick_ms_mean = r.f32();
+                stats.tick_ms_max  = r.f32();
+                stats.bytes_per_s  = r.varint();
+                break;
+            default: r.ok = false; break;
+        }
+    });
+    connection->flush();
+}
@@ -0,0 +1,371 @@
+#ifndef NET_HPP
+#define NET_HPP
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block.hpp"
+#include "chunk.hpp"
+#include "math.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+class BlockManager;
+
+/*
+ * Messages between craft-server and its clients. Each is framed as a varint length, a NetMessage byte and the payload.
+ * Integers are varints, zigzag encoded when signed, and floats are 4 little-endian bytes.
+ */
+enum class NetMessage : uint8_t
+{
+    // Client to server.
+    hello,     // (nothing)
+    move,      // pos, forward, velocity, load range
+    add_block, // block id, block
+    del_block, // block id
+
+    // Server to client.
+    welcome,     // client id
+    chunk,       // chunk id, blocks (see encode_chunk)
+    chunk_delta, // chunk id, changed blocks since the last chunk or delta of the chunk (see encode_delta)
+    unload,      // chunk id
+    stats,       // clients, mean and max tick time in ms, bytes sent per second
+};
+
+class NetWriter
+{
+public:
+    vector<uint8_t> data {};
+
+public:
+    void u8(uint8_t v)
+    {
+        data.push_back(v);
+    }
+
+    void varint(uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(v | 0x80u));
+            v >>= 7u;
+        }
+        data.push_back(static_cast<uint8_t>(v));
+    }
+
+    void svarint(int64_t v)
+    {
+        varint(static_cast<uint64_t>(v) << 1u ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    void f32(float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        for (int i = 0; i < 4; i++)
+        {
+            data.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    void vec(vec3 const& v)
+    {
+        f32(v.x);
+        f32(v.y);
+        f32(v.z);
+    }
+
+    void block_id(BlockID const& block_id)
+    {
+        svarint(block_id.x);
+        svarint(block_id.y);
+        u8(block_id.z);
+    }
+
+    void chunk_id(ChunkID const& chunk_id)
+    {
+        svarint(static_cast<int32_t>(chunk_id.x) / static_cast<int32_t>(CHUNK_WIDTH));
+        svarint(static_cast<int32_t>(chunk_id.y) / static_cast<int32_t>(CHUNK_WIDTH));
+    }
+
+    void block(BlockData const& block)
+    {
+        varint(block.bits());
+    }
+};
+
+// Reads a message's payload. Reading past its end yields zeros and clears ok.
+class NetReader
+{
+private:
+    uint8_t const* p;
+    uint8_t const* end;
+
+public:
+    bool ok = true;
+
+public:
+    NetReader(uint8_t const* p, uint8_t const* end) : p(p), end(end)
+    {
+    }
+
+    [[nodiscard]] bool at_end() const
+    {
+        return p == end;
+    }
+
+    [[nodiscard]] uint8_t const* pos() const
+    {
+        return p;
+    }
+
+    uint8_t u8()
+    {
+        if (p == end)
+        {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7fu) << shift;
+            if ((b & 0x80u) == 0)
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t svarint()
+    {
+        uint64_t v = varint();
+        return static_cast<int64_t>(v >> 1u ^ (~(v & 1u) + 1));
+    }
+
+    float f32()
+    {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            bits |= static_cast<uint32_t>(u8()) << (8 * i);
+        }
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    vec3 vec()
+    {
+        float x = f32(), y = f32(), z = f32();
+        return vec3(x, y, z);
+    }
+
+    BlockID block_id()
+    {
+        auto x = static_cast<int32_t>(svarint());
+        auto y = static_cast<int32_t>(svarint());
+        return BlockID { x, y, u8() };
+    }
+
+    ChunkID chunk_id()
+    {
+        auto x = static_cast<int32_t>(svarint());
+        auto y = static_cast<int32_t>(svarint());
+        return ChunkID { x * static_cast<int32_t>(CHUNK_WIDTH), y * static_cast<int32_t>(CHUNK_WIDTH) };
+    }
+
+    BlockData block()
+    {
+        BlockData block = BlockData::from_bits(static_cast<uint16_t>(varint()));
+        if (!BlockRegistry::is_registered(block.type()))
+        {
+            ok = false;
+            return BlockData {};
+        }
+        return block;
+    }
+};
+
+/*
+ * Blocks of a chunk, column by column: the number of runs of the column, then the block and the length of each run. A
+ * column the same as the one before it is a single 0.
+ */
+void encode_chunk(NetWriter& w, ChunkSnapshot const& snapshot);
+
+bool decode_chunk(NetReader& r, ChunkSnapshot& snapshot);
+
+/*
+ * The blocks of to that differ from from, two snapshots of the same chunk: their number, then for each the gap from the
+ * index of the previous one (s << 12 | x << 8 | y << 4 | z & 15 for section s) and the block. Sections the snapshots share
+ * are skipped without reading them. Returns the number of blocks.
+ */
+size_t encode_delta(NetWriter& w, ChunkSnapshot const& from, ChunkSnapshot const& to);
+
+// A non-blocking TCP connection, with what is left to send and what was received short of a whole message.
+class Connection : private NonCopy<Connection>
+{
+public:
+    // Chunks of generated terrain take a few KiB, a chunk with a block of its own in every column 200 KiB.
+    static constexpr uint64_t MAX_MESSAGE_SIZE = 1u << 20u;
+
+    // The size of a message is a varint, at most 10 bytes.
+    static constexpr size_t MAX_HEADER_SIZE = 10;
+
+private:
+    intptr_t        fd;
+    vector<uint8_t> in {}, out {};
+    size_t          out_sent = 0;
+
+public:
+    uint64_t bytes_sent = 0, bytes_received = 0;
+
+public:
+    explicit Connection(intptr_t fd);
+
+    ~Connection();
+
+    // Throws if host cannot be reached.
+    static unique_ptr<Connection> connect(string const& host, uint16_t port);
+
+    [[nodiscard]] bool is_open() const
+    {
+        return fd >= 0;
+    }
+
+    // Bytes queued and not taken by the socket yet.
+    [[nodiscard]] size_t pending() const
+    {
+        return out.size() - out_sent;
+    }
+
+    // Queues w as one message of type type, and clears it.
+    void send(NetMessage type, NetWriter& w);
+
+    // Writes what the socket takes without blocking.
+    void flush();
+
+    // Reads what arrived and calls f(type, reader) for every whole message. A malformed message closes the connection.
+    template<typename F>
+    void receive(F&& f)
+    {
+        if (!read())
+            return;
+
+        size_t i = 0;
+        while (i < in.size())
+        {
+            NetReader header { in.data() + i, in.data() + in.size() };
+            uint64_t  size = header.varint();
+            if (!header.ok)
+            {
+                // Short of a whole varint, or not one at all once it has the bytes of the longest.
+                if (in.size() - i >= MAX_HEADER_SIZE)
+                {
+                    close();
+                    return;
+                }
+                break;
+            }
+            if (size == 0 || size > MAX_MESSAGE_SIZE)
+            {
+                close();
+                return;
+            }
+            auto start = static_cast<size_t>(header.pos() - in.data());
+            if (start + size > in.size())
+                break;
+
+            NetReader r { in.data() + start + 1, in.data() + start + size };
+            f(static_cast<NetMessage>(in[start]), r);
+            if (!r.ok)
+            {
+                close();
+                return;
+            }
+            i = start + size;
+        }
+        in.erase(in.begin(), in.begin() + static_cast<ptrdiff_t>(i));
+
+        // What is left is short of one message, a peer sending more is broken.
+        if (in.size() > MAX_MESSAGE_SIZE + MAX_HEADER_SIZE)
+            close();
+    }
+
+    void close();
+
+private:
+    // Appends what arrived to in. Returns false once the connection is closed.
+    bool read();
+};
+
+class Listener : private NonCopy<Listener>
+{
+private:
+    intptr_t fd;
+
+public:
+    // Throws if port cannot be bound.
+    explicit Listener(uint16_t port);
+
+    ~Listener();
+
+    // A client waiting to connect, nullptr if there is none.
+    unique_ptr<Connection> accept();
+};
+
+struct ServerStats
+{
+    uint32_t n_clients    = 0;
+    float    tick_ms_mean = 0.f, tick_ms_max = 0.f;
+    uint64_t bytes_per_s  = 0;
+};
+
+/*
+ * A connection to craft-server. It sends the player's moves and edits, and replicates the chunks of the server around
+ * the player into a BlockManager.
+ */
+class NetClient : private NonCopy<NetClient>
+{
+private:
+    unique_ptr<Connection> connection;
+
+public:
+    uint32_t    id = 0;
+    ServerStats stats {};
+    uint64_t    n_chunks = 0, n_deltas = 0;
+
+public:
+    // Throws if the server cannot be reached.
+    NetClient(string const& host, uint16_t port);
+
+    [[nodiscard]] bool is_open() const
+    {
+        return connection->is_open();
+    }
+
+    [[nodiscard]] Connection const& get_connection() const
+    {
+        return *connection;
+    }
+
+    void send_move(vec3 const& pos, vec3 const& forward, vec3 const& velocity, int32_t range);
+
+    void send_add_block(BlockID const& block_id, BlockData const& block);
+
+    void send_del_block(BlockID const& block_id);
+
+    // Applies what the server sent to block_manager, or only decodes it without one.
+    void receive(BlockManager* block_manager);
+};
+
+#endif
@@ -12,13 +12,6 @@
 
 using namespace std;
 
-enum State
-{
-    Fixed,
-    Normal,
-    Falling,
-};
-
 class Object
 {
 public:
@@ -32,13 +25,7 @@ public:
 public:
     void transit_state(State new_state)
     {
-        switch (new_state)
-        {
-            case Fixed: velocity = vec3(0.f, 0.f, 0.f); break;
-            case Normal: velocity.z = 0.f; break;
-            case Falling: velocity.z -= gravity_acc; break;
-        }
-        state = new_state;
+        ::transit_state(state, velocity, new_state);
     }
 
     void jump()
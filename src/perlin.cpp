@@ -0,0 +1,268 @@
+#include "perlin.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#if defined(__AVX2__)
+    struct Lanes
+    {
+        static constexpr uint32_t N = 8;
+
+        using F = __m256;
+        using I = __m256i;
+
+        static F loadf(float const* v) { return _mm256_loadu_ps(v); }
+        static I loadi(int32_t const* v) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(v)); }
+        static void store(float* v, F a) { _mm256_storeu_ps(v, a); }
+        static F setf(float v) { return _mm256_set1_ps(v); }
+        static I seti(int32_t v) { return _mm256_set1_epi32(v); }
+
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+
+        static I bit_and(I a, I b) { return _mm256_and_si256(a, b); }
+        static I bit_or(I a, I b) { return _mm256_or_si256(a, b); }
+        template<int n>
+        static I shl(I a) { return _mm256_slli_epi32(a, n); }
+        static I cmpeq(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+        static I cmplt(I a, I b) { return _mm256_cmpgt_epi32(b, a); }
+
+        static I gather(int const* table, I idx) { return _mm256_i32gather_epi32(table, idx, 4); }
+        static F select(I mask, F a, F b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+        static F flip_sign(F a, I sign) { return _mm256_xor_ps(a, _mm256_castsi256_ps(sign)); }
+    };
+#elif defined(__SSE2__) || defined(_M_X64)
+    struct Lanes
+    {
+        static constexpr uint32_t N = 4;
+
+        using F = __m128;
+        using I = __m128i;
+
+        static F loadf(float const* v) { return _mm_loadu_ps(v); }
+        static I loadi(int32_t const* v) { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(v)); }
+        static void store(float* v, F a) { _mm_storeu_ps(v, a); }
+        static F setf(float v) { return _mm_set1_ps(v); }
+        static I seti(int32_t v) { return _mm_set1_epi32(v); }
+
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static I add(I a, I b) { return _mm_add_epi32(a, b); }
+
+        static I bit_and(I a, I b) { return _mm_and_si128(a, b); }
+        static I bit_or(I a, I b) { return _mm_or_si128(a, b); }
+        template<int n>
+        static I shl(I a) { return _mm_slli_epi32(a, n); }
+        static I cmpeq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+        static I cmplt(I a, I b) { return _mm_cmplt_epi32(a, b); }
+
+        // SSE2 has no gather, the table lookups stay scalar.
+        static I gather(int const* table, I idx)
+        {
+            alignas(16) int32_t i[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(i), idx);
+            return _mm_set_epi32(table[i[3]], table[i[2]], table[i[1]], table[i[0]]);
+        }
+        static F select(I mask, F a, F b)
+        {
+            F m = _mm_castsi128_ps(mask);
+            return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+        }
+        static F flip_sign(F a, I sign) { return _mm_xor_ps(a, _mm_castsi128_ps(sign)); }
+    };
+#else
+    struct Lanes
+    {
+        static constexpr uint32_t N = 1;
+
+        using F = float;
+        using I = uint32_t;
+
+        static F loadf(float const* v) { return *v; }
+        static I loadi(int32_t const* v) { return static_cast<uint32_t>(*v); }
+        static void store(float* v, F a) { *v = a; }
+        static F setf(float v) { return v; }
+        static I seti(int32_t v) { return static_cast<uint32_t>(v); }
+
+        static F add(F a, F b) { return a + b; }
+        static F sub(F a, F b) { return a - b; }
+        static F mul(F a, F b) { return a * b; }
+        static I add(I a, I b) { return a + b; }
+
+        static I bit_and(I a, I b) { return a & b; }
+        static I bit_or(I a, I b) { return a | b; }
+        template<int n>
+        static I shl(I a) { return a << n; }
+        static I cmpeq(I a, I b) { return a == b ? ~0u : 0u; }
+        static I cmplt(I a, I b) { return a < b ? ~0u : 0u; }
+
+        static I gather(int const* table, I idx) { return static_cast<uint32_t>(table[idx]); }
+        static F select(I mask, F a, F b) { return mask != 0 ? a : b; }
+        static F flip_sign(F a, I sign)
+        {
+            uint32_t bits;
+            memcpy(&bits, &a, sizeof(bits));
+            bits ^= sign;
+            memcpy(&a, &bits, sizeof(bits));
+            return a;
+        }
+    };
+#endif
+
+    using F = Lanes::F;
+    using I = Lanes::I;
+
+    // Lattice cells (already masked to the permutation table) and fractions along one axis, padded to whole lanes.
+    struct Axis
+    {
+        vector<int32_t> cell;
+        vector<float>   frac;
+
+        Axis(int32_t v0, uint32_t n, int32_t period)
+        {
+            uint32_t padded = (n + Lanes::N - 1) / Lanes::N * Lanes::N;
+            cell.resize(padded);
+            frac.resize(padded);
+            for (uint32_t i = 0; i < padded; i++)
+            {
+                int64_t v = static_cast<int64_t>(v0) + i;
+                int64_t q = v / period;
+                int64_t r = v % period;
+                if (r < 0)
+                {
+                    q--;
+                    r += period;
+                }
+                cell[i] = static_cast<int32_t>(q & 255);
+                frac[i] = static_cast<float>(r) / static_cast<float>(period);
+            }
+        }
+    };
+
+    F fade(F t)
+    {
+        // t * t * t * (t * (t * 6 - 15) + 10)
+        F r = Lanes::sub(Lanes::mul(t, Lanes::setf(6.f)), Lanes::setf(15.f));
+        r   = Lanes::add(Lanes::mul(t, r), Lanes::setf(10.f));
+        return Lanes::mul(Lanes::mul(Lanes::mul(t, t), t), r);
+    }
+
+    F lerp(F t, F a, F b)
+    {
+        return Lanes::add(a, Lanes::mul(t, Lanes::sub(b, a)));
+    }
+
+    F grad(I hash, F x, F y, F z)
+    {
+        I h = Lanes::bit_and(hash, Lanes::seti(15));
+        F u = Lanes::select(Lanes::cmplt(h, Lanes::seti(8)), x, y);
+        F v = Lanes::select(Lanes::cmplt(h, Lanes::seti(4)),
+                            y,
+                            Lanes::select(Lanes::bit_or(Lanes::cmpeq(h, Lanes::seti(12)), Lanes::cmpeq(h, Lanes::seti(14))), x, z));
+        u   = Lanes::flip_sign(u, Lanes::shl<31>(Lanes::bit_and(h, Lanes::seti(1))));
+        v   = Lanes::flip_sign(v, Lanes::shl<30>(Lanes::bit_and(h, Lanes::seti(2))));
+        return Lanes::add(u, v);
+    }
+
+    // h holds AA, BA, AB and BB of noise(); the z + 1 corners, used when Z is set, are at AA + 1 etc.
+    template<bool Z>
+    F blend(int const* p, I const (&h)[4], F x, F y, F z)
+    {
+        F one = Lanes::setf(1.f);
+        F x1  = Lanes::sub(x, one);
+        F y1  = Lanes::sub(y, one);
+        F u   = fade(x);
+        F v   = fade(y);
+
+        F r = lerp(v,
+                   lerp(u, grad(Lanes::gather(p, h[0]), x, y, z), grad(Lanes::gather(p, h[1]), x1, y, z)),
+                   lerp(u, grad(Lanes::gather(p, h[2]), x, y1, z), grad(Lanes::gather(p, h[3]), x1, y1, z)));
+        if constexpr (Z)
+        {
+            I   i1 = Lanes::seti(1);
+            F   z1 = Lanes::sub(z, one);
+            F   w  = fade(z);
+            F   r1 = lerp(v,
+                        lerp(u, grad(Lanes::gather(p, Lanes::add(h[0], i1)), x, y, z1), grad(Lanes::gather(p, Lanes::add(h[1], i1)), x1, y, z1)),
+                        lerp(u, grad(Lanes::gather(p, Lanes::add(h[2], i1)), x, y1, z1), grad(Lanes::gather(p, Lanes::add(h[3], i1)), x1, y1, z1)));
+            r = lerp(w, r, r1);
+        }
+        return r;
+    }
+
+    void store_lanes(float* out, F r, uint32_t n)
+    {
+        if (n == Lanes::N)
+        {
+            Lanes::store(out, r);
+            return;
+        }
+        float tmp[Lanes::N];
+        Lanes::store(tmp, r);
+        copy(tmp, tmp + n, out);
+    }
+}
+
+void PerlinNoise::noise_grid(int32_t x0, int32_t y0, uint32_t nx, uint32_t ny, int32_t period, float* out)
+{
+    Axis ax { x0, nx, period }, ay { y0, ny, period };
+
+    // Lanes run along y, z is fixed at 0 so only the lower four corners contribute.
+    for (uint32_t i = 0; i < nx; i++)
+    {
+        I pX  = Lanes::seti(p[ax.cell[i]]);
+        I pX1 = Lanes::seti(p[ax.cell[i] + 1]);
+        F x   = Lanes::setf(ax.frac[i]);
+        for (uint32_t j = 0; j < ny; j += Lanes::N)
+        {
+            I Y = Lanes::loadi(&ay.cell[j]);
+            F y = Lanes::loadf(&ay.frac[j]);
+
+            I A = Lanes::add(pX, Y), B = Lanes::add(pX1, Y);
+            I one = Lanes::seti(1);
+            I h[4] = {
+                Lanes::gather(p, A),
+                Lanes::gather(p, B),
+                Lanes::gather(p, Lanes::add(A, one)),
+                Lanes::gather(p, Lanes::add(B, one)),
+            };
+            store_lanes(&out[i * ny + j], blend<false>(p, h, x, y, Lanes::setf(0.f)), min(Lanes::N, ny - j));
+        }
+    }
+}
+
+void PerlinNoise::noise_grid(int32_t x0, int32_t y0, int32_t z0, uint32_t nx, uint32_t ny, uint32_t nz, int32_t period, float* out)
+{
+    Axis ax { x0, nx, period }, ay { y0, ny, period }, az { z0, nz, period };
+
+    // Lanes run along z.
+    for (uint32_t i = 0; i < nx; i++)
+    {
+        F x = Lanes::setf(ax.frac[i]);
+        for (uint32_t j = 0; j < ny; j++)
+        {
+            int A = p[ax.cell[i]] + ay.cell[j], B = p[ax.cell[i] + 1] + ay.cell[j];
+            I pA = Lanes::seti(p[A]), pA1 = Lanes::seti(p[A + 1]), pB = Lanes::seti(p[B]), pB1 = Lanes::seti(p[B + 1]);
+            F y = Lanes::setf(ay.frac[j]);
+            for (uint32_t k = 0; k < nz; k += Lanes::N)
+            {
+                I Z    = Lanes::loadi(&az.cell[k]);
+                F z    = Lanes::loadf(&az.frac[k]);
+                I h[4] = { Lanes::add(pA, Z), Lanes::add(pB, Z), Lanes::add(pA1, Z), Lanes::add(pB1, Z) };
+                store_lanes(&out[(i * ny + j) * nz + k], blend<true>(p, h, x, y, z), min(Lanes::N, nz - k));
+            }
+        }
+    }
+}
@@ -2,6 +2,7 @@
 #define PERLIN_HPP
 
 #include <cmath>
+#include <cstdint>
 
 using namespace std;
 
@@ -21,6 +22,19 @@ public:
                     lerp(v, lerp(u, grad(p[AA + 1], x, y, z - 1), grad(p[BA + 1], x - 1, y, z - 1)), lerp(u, grad(p[AB + 1], x, y - 1, z - 1), grad(p[BB + 1], x - 1, y - 1, z - 1))));
     }
 
+    /*
+     * Batch versions of noise() over integer grids, evaluated in float lanes (AVX2, SSE2 or scalar, chosen at compile
+     * time). Coordinates are divided by period, the lattice cell and fraction are derived exactly in integer arithmetic,
+     * so results stay within NOISE_GRID_TOLERANCE of noise() for any int32 input.
+     */
+    static constexpr float NOISE_GRID_TOLERANCE = 2e-6f;
+
+    // out[i * ny + j] = noise((x0 + i) / period, (y0 + j) / period, 0)
+    static void noise_grid(int32_t x0, int32_t y0, uint32_t nx, uint32_t ny, int32_t period, float* out);
+
+    // out[(i * ny + j) * nz + k] = noise((x0 + i) / period, (y0 + j) / period, (z0 + k) / period)
+    static void noise_grid(int32_t x0, int32_t y0, int32_t z0, uint32_t nx, uint32_t ny, uint32_t nz, int32_t period, float* out);
+
 private:
     static double fade(double t)
     {
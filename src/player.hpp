@@ -43,9 +43,9 @@ public:
         DB::ins().player_pos = pos;
     }
 
-    void update()
+    void update(BlockManager& block_manager)
     {
-        target = Ray::cast_block(pos, forward, 24);
+        target = Ray::cast_block(block_manager, pos, forward, 24);
     }
 
 #define MOVE_FUNC(d, v, as1, as2)                            \
@@ -82,6 +82,11 @@ public:
         update_velocity();
     }
 
+    [[nodiscard]] vec3 get_forward() const
+    {
+        return forward;
+    }
+
     [[nodiscard]] mat4 get_mvp() const
     {
         const mat4 projection = perspective(FOVY, ASPECT, Z_NEAR, Z_FAR);
@@ -0,0 +1,121 @@
+#include "profile.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+static atomic<bool> trace_requested { false };
+
+static thread_local Profiler const* ring_owner = nullptr;
+static thread_local void*           ring_ptr   = nullptr;
+
+// Writes s as the contents of a JSON string, escaping quotes, backslashes and control characters.
+static void write_json_string(ostream& out, char const* s)
+{
+    for (; *s != '\0'; s++)
+    {
+        auto c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << *s;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        }
+        else
+        {
+            out << *s;
+        }
+    }
+}
+
+Profiler::Profiler()
+{
+    enabled = getenv("CRAFT_PROFILE") != nullptr;
+}
+
+Profiler::Ring& Profiler::thread_ring()
+{
+    if (ring_owner == this)
+    {
+        return *static_cast<Ring*>(ring_ptr);
+    }
+
+    lock_guard lock { rings_mutex };
+    auto       ring   = make_unique<Ring>();
+    ring->tid         = static_cast<uint32_t>(rings.size());
+    ring->thread_name = "thread " + to_string(ring->tid);
+    ring_owner        = this;
+    ring_ptr          = ring.get();
+    rings.push_back(move(ring));
+    return *rings.back();
+}
+
+void Profiler::set_thread_name(string name)
+{
+    Ring& ring = thread_ring();
+
+    lock_guard lock { rings_mutex };
+    ring.thread_name = move(name);
+}
+
+void Profiler::request_trace()
+{
+    trace_requested = true;
+}
+
+bool Profiler::take_trace_request()
+{
+    return trace_requested.exchange(false);
+}
+
+void Profiler::install_signal()
+{
+#ifdef SIGUSR1
+    signal(SIGUSR1, [](int) { trace_requested = true; });
+#endif
+}
+
+bool Profiler::write_trace(string const& path) const
+{
+    ofstream out { path };
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out << fixed << setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    lock_guard lock { rings_mutex };
+    bool       first = true;
+    for (auto const& ring : rings)
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->tid << ",\"args\":{\"name\":\"";
+        write_json_string(out, ring->thread_name.c_str());
+        out << "\"}}";
+        first = false;
+
+        // The thread keeps recording, an event it overwrote while it was read is dropped.
+        uint64_t head = ring->head.load(memory_order_acquire);
+        for (uint64_t i = head > RING_SIZE ? head - RING_SIZE : 0; i < head; i++)
+        {
+            Event const& event = ring->events[i % RING_SIZE];
+            char const*  name  = event.name.load(memory_order_relaxed);
+            uint64_t     start = event.start.load(memory_order_relaxed), end = event.end.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (i + RING_SIZE < ring->writing.load(memory_order_relaxed))
+                continue;
+
+            out << ",\n{\"name\":\"";
+            write_json_string(out, name);
+            out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->tid << ",\"ts\":" << static_cast<double>(start) / 1e3
+                << ",\"dur\":" << static_cast<double>(end - start) / 1e3 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,140 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * Scoped timing zones. PROFILE_ZONE("name") times the rest of the enclosing scope into a ring buffer of the calling
+ * thread while the profiler is enabled, and only costs a check of the flag while it is not. Builds without CRAFT_PROFILE
+ * compile the zones out. write_trace() exports what the rings hold as Chrome trace JSON, for chrome://tracing or Perfetto.
+ *
+ * The profiler starts enabled when the CRAFT_PROFILE environment variable is set, so startup is recorded too.
+ */
+class Profiler : public Singleton<Profiler>
+{
+public:
+    // Zones kept per thread, the oldest are overwritten.
+    static constexpr uint64_t RING_SIZE = 1u << 16u;
+
+private:
+    // The fields are atomic so a trace can be written while the thread records, see write_trace().
+    struct Event
+    {
+        atomic<char const*> name { nullptr };
+        atomic<uint64_t>    start { 0 }, end { 0 };
+    };
+
+    struct Ring
+    {
+        string              thread_name;
+        uint32_t            tid;
+        unique_ptr<Event[]> events { new Event[RING_SIZE] };
+
+        // Events before head are written, the one before writing may be being written.
+        atomic<uint64_t> head { 0 }, writing { 0 };
+    };
+
+    atomic<bool>                     enabled { false };
+    chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+    mutable mutex            rings_mutex {};
+    vector<unique_ptr<Ring>> rings {};
+
+public:
+    Profiler();
+
+    [[nodiscard]] bool is_enabled() const
+    {
+        return enabled.load(memory_order_relaxed);
+    }
+
+    void set_enabled(bool on)
+    {
+        enabled.store(on, memory_order_relaxed);
+    }
+
+    // Nanoseconds since the profiler started.
+    [[nodiscard]] uint64_t now() const
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count());
+    }
+
+    void record(char const* name, uint64_t start, uint64_t end)
+    {
+        Ring&    ring  = thread_ring();
+        uint64_t i     = ring.head.load(memory_order_relaxed);
+        Event&   event = ring.events[i % RING_SIZE];
+        ring.writing.store(i + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        event.name.store(name, memory_order_relaxed);
+        event.start.store(start, memory_order_relaxed);
+        event.end.store(end, memory_order_relaxed);
+        ring.head.store(i + 1, memory_order_release);
+    }
+
+    // Names the calling thread in traces.
+    void set_thread_name(string name);
+
+    // Asks the main loop for a trace, from a key press or SIGUSR1 once install_signal() ran.
+    void request_trace();
+
+    // Whether a trace was requested since the last call.
+    bool take_trace_request();
+
+    static void install_signal();
+
+    // Writes the zones every thread still holds. Returns false if path cannot be written.
+    bool write_trace(string const& path) const;
+
+private:
+    Ring& thread_ring();
+};
+
+class ProfileZone : private NonCopy<ProfileZone>
+{
+private:
+    char const* name;
+    uint64_t    start  = 0;
+    bool        active = false;
+
+public:
+    explicit ProfileZone(char const* name) : name(name)
+    {
+        Profiler& profiler = Profiler::ins();
+        if (profiler.is_enabled())
+        {
+            active = true;
+            start  = profiler.now();
+        }
+    }
+
+    ~ProfileZone()
+    {
+        if (active)
+        {
+            Profiler& profiler = Profiler::ins();
+            profiler.record(name, start, profiler.now());
+        }
+    }
+};
+
+#ifdef CRAFT_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name)    ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__) { name }
+#define PROFILE_THREAD(name)  Profiler::ins().set_thread_name(name)
+#else
+#define PROFILE_ZONE(name)   ((void) 0)
+#define PROFILE_THREAD(name) ((void) 0)
+#endif
+
+#endif
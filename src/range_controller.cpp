@@ -0,0 +1,39 @@
+#include "range_controller.hpp"
+
+#include <algorithm>
+
+#include "memory.hpp"
+
+int32_t RangeController::update(int32_t range, float work_ms, float del_t)
+{
+    if (!enabled)
+    {
+        return range;
+    }
+
+    // Averaged over about a quarter of the hold time, a single slow frame changes nothing.
+    frame_ms += (work_ms - frame_ms) * min(1.f, del_t / (RANGE_HOLD_MS / 4.f));
+    held_ms += del_t;
+    if (held_ms < RANGE_HOLD_MS)
+    {
+        return range;
+    }
+
+    // Memory grows with the area of the window, (2 * range + 1)^2 chunks.
+    auto   memory = static_cast<double>(Memory::ins().total());
+    double budget = static_cast<double>(MEMORY_BUDGET_MIB) * 1024. * 1024.;
+    double grow   = static_cast<double>(2 * range + 3) / static_cast<double>(2 * range + 1);
+
+    int32_t next = range;
+    if (frame_ms > FRAME_TIME_TARGET_MS || memory > budget)
+        next = range - 1;
+    else if (frame_ms < FRAME_TIME_TARGET_MS * RANGE_GROW_BELOW && memory * grow * grow < budget)
+        next = range + 1;
+    next = clamp(next, LOAD_RANGE_MIN, LOAD_RANGE_MAX);
+
+    if (next != range)
+    {
+        held_ms = 0.f;
+    }
+    return next;
+}
@@ -0,0 +1,32 @@
+#ifndef RANGE_CONTROLLER_HPP
+#define RANGE_CONTROLLER_HPP
+
+#include <cstdint>
+
+#include "config.hpp"
+
+using namespace std;
+
+/*
+ * Picks the load range from the time frames take and the memory in use, see RANGE_ADAPTIVE. Between growing and
+ * shrinking is a band of frame times where it keeps the range, and after each change it holds the range for RANGE_HOLD_MS,
+ * so that the loads and unloads of one change do not cause the next.
+ */
+class RangeController
+{
+private:
+    // Average time of the frames, ms.
+    float frame_ms = 0.f;
+
+    // Time since the last change, ms.
+    float held_ms = 0.f;
+
+public:
+    bool enabled = RANGE_ADAPTIVE;
+
+public:
+    // The range for the next frames, after a frame at range that took work_ms of its del_t ms.
+    int32_t update(int32_t range, float work_ms, float del_t);
+};
+
+#endif
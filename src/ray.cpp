@@ -1,10 +1,12 @@
 #include "ray.hpp"
 
-#include "scene.hpp"
+#include "chunk_cursor.hpp"
+
+#include <climits>
 
 constexpr float MAX_DISTANCE = 4294967295.f;
 
-optional<array<BlockID, 2>> Ray::cast_block(vec3 const& p0, vec3 const& dir, float max_distance)
+optional<array<BlockID, 2>> Ray::cast_block(BlockManager& block_manager, vec3 const& p0, vec3 const& dir, float max_distance)
 {
     array<int32_t, 3> curr {};
     array<int32_t, 3> step {};
@@ -14,9 +16,9 @@ optional<array<BlockID, 2>> Ray::cast_block(vec3 const& p0, vec3 const& dir, flo
 
     for (int i = 0; i < 3; i++)
     {
+        curr[i] = static_cast<int32_t>(floor(p0[i]));
         if (dir[i] != 0.f)
         {
-            curr[i] = static_cast<int32_t>(floor(p0[i]));
             step[i] = dir[i] > 0.f ? 1 : -1;
             compute_next_distance(i);
         }
@@ -26,6 +28,8 @@ optional<array<BlockID, 2>> Ray::cast_block(vec3 const& p0, vec3 const& dir, flo
         }
     }
 
+    ChunkCursor cursor { block_manager, curr[0], curr[1], curr[2] };
+
     for (;;)
     {
         int i = 0;
@@ -38,11 +42,11 @@ optional<array<BlockID, 2>> Ray::cast_block(vec3 const& p0, vec3 const& dir, flo
             break;
 
         curr[i] += step[i];
+        cursor.step(i, step[i]);
 
-        BlockID          block_id { curr[0], curr[1], curr[2] };
-        BlockData const* block = Scene::ins().block_manager.get_block(block_id);
-        if (block != nullptr)
+        if (cursor.get() != nullptr)
         {
+            BlockID block_id { curr[0], curr[1], curr[2] };
             curr[i] -= step[i];
             BlockID block_id_front { curr[0], curr[1], curr[2] };
             return { { { block_id, block_id_front } } };
@@ -53,3 +57,160 @@ optional<array<BlockID, 2>> Ray::cast_block(vec3 const& p0, vec3 const& dir, flo
 
     return nullopt;
 }
+
+// The same walk as cast_block, in boxes of cells known to be empty. Where the ray leaves a box, and which cells it is in
+// at that point, are worked out with cast_block's own next_distance values, so the cells and results match it exactly.
+static optional<array<BlockID, 2>> cast_skipping(ChunkCursor& cursor, vec3 const& p0, vec3 const& dir, float max_distance)
+{
+    array<int32_t, 3> curr {};
+    array<int32_t, 3> step {};
+
+    // cast_block's next_distance of cell c on axis i, INT_MIN and INT_MAX stand for an unbounded box.
+    auto next_distance = [&](int i, int32_t c) {
+        if (step[i] == 0 || c == INT_MIN || c == INT_MAX)
+            return MAX_DISTANCE;
+        return (static_cast<float>(c + (step[i] < 0 ? 0 : 1)) - p0[i]) / dir[i];
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        curr[i] = static_cast<int32_t>(floor(p0[i]));
+        step[i] = dir[i] > 0.f ? 1 : dir[i] < 0.f ? -1 : 0;
+    }
+
+    // next_distance of the current cell, kept up to date like in cast_block.
+    array<float, 3> nd {};
+    for (int a = 0; a < 3; a++)
+    {
+        nd[a] = next_distance(a, curr[a]);
+    }
+
+    // The box is inclusive. cast_block does not look at the starting cell, so it starts as a box of its own.
+    array<int32_t, 3> lo = curr, hi = curr;
+    for (;;)
+    {
+        // The axis the ray leaves the box along, ties going to the lower axis like in cast_block.
+        int   i = 0;
+        float t = 0.f;
+        if (lo == hi)
+        {
+            if (nd[1] < nd[i])
+                i = 1;
+            if (nd[2] < nd[i])
+                i = 2;
+            t = nd[i];
+        }
+        else
+        {
+            array<float, 3> d {};
+            for (int a = 0; a < 3; a++)
+            {
+                d[a] = next_distance(a, step[a] > 0 ? hi[a] : lo[a]);
+            }
+            if (d[1] < d[i])
+                i = 1;
+            if (d[2] < d[i])
+                i = 2;
+            t = d[i];
+            if (t > max_distance)
+            {
+                return nullopt;
+            }
+
+            curr[i] = step[i] > 0 ? hi[i] : lo[i];
+
+            // The other axes advance while their next boundary comes first, or at the same distance on a lower axis.
+            for (int a = 0; a < 3; a++)
+            {
+                if (a == i || step[a] == 0)
+                    continue;
+
+                auto before = [&](int32_t c) {
+                    float d_c = next_distance(a, c);
+                    return d_c < t || (d_c == t && a < i);
+                };
+
+                auto c = static_cast<int32_t>(floor(p0[a] + dir[a] * t));
+                c      = step[a] > 0 ? clamp(c, curr[a], hi[a]) : clamp(c, lo[a], curr[a]);
+                while (c != curr[a] && !before(c - step[a]))
+                    c -= step[a];
+                while (before(c))
+                    c += step[a];
+                if (c != curr[a])
+                {
+                    curr[a] = c;
+                    nd[a]   = next_distance(a, c);
+                }
+            }
+        }
+        if (t > max_distance)
+        {
+            return nullopt;
+        }
+
+        array<int32_t, 3> front = curr;
+        curr[i] += step[i];
+        nd[i] = next_distance(i, curr[i]);
+        cursor.move_to(curr[0], curr[1], curr[2]);
+
+        // Find the largest empty box around the new cell, or the block in it.
+        Chunk const* chunk = cursor.get_chunk();
+        auto         x0    = static_cast<int32_t>(static_cast<uint32_t>(curr[0]) & CHUNK_ID_MASK);
+        auto         y0    = static_cast<int32_t>(static_cast<uint32_t>(curr[1]) & CHUNK_ID_MASK);
+        auto         x     = static_cast<uint16_t>(curr[0] - x0);
+        auto         y     = static_cast<uint16_t>(curr[1] - y0);
+        int32_t      z     = curr[2];
+
+        lo = { x0, y0, z };
+        hi = { x0 + static_cast<int32_t>(CHUNK_WIDTH) - 1, y0 + static_cast<int32_t>(CHUNK_WIDTH) - 1, z };
+        if (chunk == nullptr)
+        {
+            lo[2] = INT_MIN;
+            hi[2] = INT_MAX;
+        }
+        else if (z < 0)
+        {
+            lo[2] = INT_MIN;
+            hi[2] = -1;
+        }
+        else if (z >= chunk->max_height())
+        {
+            lo[2] = chunk->max_height();
+            hi[2] = INT_MAX;
+        }
+        else if (chunk->is_section_empty(static_cast<uint8_t>(z)))
+        {
+            lo[2] = z & ~15;
+            hi[2] = (z & ~15) + 15;
+        }
+        else if (z >= chunk->column_height(x, y))
+        {
+            lo    = { curr[0], curr[1], chunk->column_height(x, y) };
+            hi    = { curr[0], curr[1], INT_MAX };
+        }
+        else if (!chunk->at(x, y, static_cast<uint8_t>(z)).is_null())
+        {
+            return { { { BlockID { curr[0], curr[1], curr[2] }, BlockID { front[0], front[1], front[2] } } } };
+        }
+        else
+        {
+            lo = hi = curr;
+        }
+    }
+}
+
+void Ray::cast_blocks(BlockManager& block_manager, vector<pair<vec3, vec3>> const& rays, float max_distance, vector<optional<array<BlockID, 2>>>& results)
+{
+    results.resize(rays.size());
+    if (rays.empty())
+    {
+        return;
+    }
+
+    // One cursor for the batch, nearby rays find their chunks already looked up.
+    ChunkCursor cursor { block_manager, static_cast<int32_t>(floor(rays[0].first.x)), static_cast<int32_t>(floor(rays[0].first.y)), 0 };
+    for (size_t r = 0; r < rays.size(); r++)
+    {
+        results[r] = cast_skipping(cursor, rays[r].first, rays[r].second, max_distance);
+    }
+}
@@ -3,15 +3,25 @@
 
 #include <array>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "block.hpp"
+#include "block_manager.hpp"
 #include "math.hpp"
 
 using namespace std;
 
 namespace Ray
 {
-    optional<array<BlockID, 2>> cast_block(vec3 const& p0, vec3 const& dir, float max_distance);
+    optional<array<BlockID, 2>> cast_block(BlockManager& block_manager, vec3 const& p0, vec3 const& dir, float max_distance);
+
+    // Casts every (p0, dir) of rays, results[i] being what cast_block returns for rays[i]. Unloaded chunks, empty sections and
+    // the air above the blocks are crossed in one step each instead of cell by cell.
+    void cast_blocks(BlockManager&                        block_manager,
+                     vector<pair<vec3, vec3>> const&      rays,
+                     float                                max_distance,
+                     vector<optional<array<BlockID, 2>>>& results);
 }
 
 #endif
@@ -1,13 +1,16 @@
 #include "scene.hpp"
 
+#include "profile.hpp"
 #include "ray.hpp"
 
-void Scene::update()
+void Scene::update(float del_t, bool deterministic)
 {
-    static uint64_t last_update = time_now_ms();
+    PROFILE_ZONE("Scene::update");
 
-    uint64_t now   = time_now_ms();
-    auto     del_t = static_cast<float>(now - last_update);
+    if (client != nullptr)
+    {
+        client->receive(&block_manager);
+    }
 
     for (Object* object : object_manager.get_objects())
     {
@@ -25,7 +28,7 @@ void Scene::update()
         }
         if (object->collider != nullptr)
         {
-            Collision c = object->collider->collide(object->pos);
+            Collision c = object->collider->collide(block_manager, object->pos);
             switch (object->state)
             {
                 case State::Normal:
@@ -59,9 +62,28 @@ void Scene::update()
         }
     }
 
-    last_update = now;
+    // Block ticks run at a fixed rate, a slow frame catches up on at most a few of them. A server runs its own.
+    block_tick_time = min(block_tick_time + del_t, 4.f * BLOCK_TICK_MS);
+    while (client == nullptr && block_tick_time >= BLOCK_TICK_MS)
+    {
+        block_manager.tick(deterministic ? chrono::microseconds::max() : chrono::microseconds(BLOCK_TICK_BUDGET_US));
+        block_tick_time -= BLOCK_TICK_MS;
+    }
 
-    block_manager.update();
+    entity_manager.step(block_manager, del_t, block_manager.get_chunks_need_update());
+    Player const& player = Player::ins();
+    block_manager.update(player.pos,
+                         player.get_forward(),
+                         player.velocity,
+                         deterministic ? chrono::microseconds::max() : chrono::microseconds(CHUNK_UPDATE_BUDGET_US));
     object_manager.update();
     update_sun_dir();
+
+    // The server streams the chunks around where it was last told the player is, once a tick is enough.
+    move_time += del_t;
+    if (client != nullptr && move_time >= SERVER_TICK_MS)
+    {
+        client->send_move(player.pos, player.get_forward(), player.velocity, block_manager.get_range());
+        move_time = 0.f;
+    }
 }
@@ -2,13 +2,21 @@
 #define SCENE_HPP
 
 #include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "block.hpp"
+#include "chunk_renderer.hpp"
 #include "config.hpp"
+#include "entity.hpp"
+#include "input.hpp"
+#include "net.hpp"
 #include "object.hpp"
 #include "opengl.hpp"
 #include "player.hpp"
+#include "range_controller.hpp"
 #include "shader.hpp"
 #include "util.hpp"
 
@@ -19,21 +27,68 @@ class Scene : public Singleton<Scene>
 public:
     BlockManager  block_manager {};
     ObjectManager object_manager {};
+    ChunkRenderer chunk_renderer {};
+    EntityManager entity_manager {};
+
+    // Set once connected to a server, which then owns the world.
+    unique_ptr<NetClient> client = nullptr;
+
+    RangeController range_controller {};
+
+private:
+    // Time since the last block tick, ms.
+    float block_tick_time = 0.f;
+
+    // Time since the player's position was last sent to the server, ms.
+    float move_time = 0.f;
 
 public:
-    void init()
+    // Throws if the server cannot be reached.
+    void connect(string const& host, uint16_t port)
     {
-        block_manager.init();
+        client = make_unique<NetClient>(host, port);
+        block_manager.set_loading(false);
+        block_manager.set_ticking(false);
     }
 
     void shutdown()
     {
+        chunk_renderer.shutdown();
         block_manager.shutdown();
+        client = nullptr;
     }
 
+    // Edits go to the server when connected, and come back with the chunk's next delta.
     void add_block(BlockID const& block_id, BlockData&& block)
     {
-        block_manager.add_block(block_id, forward<BlockData>(block));
+        if (client != nullptr)
+            client->send_add_block(block_id, block);
+        else
+            block_manager.add_block(block_id, forward<BlockData>(block));
+    }
+
+    void del_block(BlockID const& block_id)
+    {
+        if (client != nullptr)
+            client->send_del_block(block_id);
+        else
+            block_manager.del_block(block_id);
+    }
+
+    void set_range(int32_t range)
+    {
+        if (range != block_manager.get_range())
+        {
+            block_manager.set_range(range);
+            InputStream::ins().record_range(block_manager.get_range());
+            cerr << "Load range " << block_manager.get_range() << endl;
+        }
+    }
+
+    // Lets range_controller pick the load range after a frame that took work_ms of its del_t ms.
+    void adapt_range(float work_ms, float del_t)
+    {
+        set_range(range_controller.update(block_manager.get_range(), work_ms, del_t));
     }
 
     void add_object(Object* obj)
@@ -41,7 +96,9 @@ public:
         object_manager.add_object(obj);
     }
 
-    void update();
+    // Steps the world by del_t ms. A deterministic step finishes the block ticks and the chunk loads instead of stopping
+    // at their time budgets, so that it only depends on del_t and the input.
+    void update(float del_t, bool deterministic = false);
 
     static void update_sun_dir()
     {
@@ -61,7 +118,7 @@ public:
     {
         ShaderManager::ins().block_shader.use();
         ShaderManager::ins().block_shader.upload_MVP(Player::ins().get_mvp());
-        block_manager.render();
+        chunk_renderer.render(block_manager);
     }
 };
 
@@ -0,0 +1,266 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "profile.hpp"
+
+static bool is_finite(vec3 const& v)
+{
+    return isfinite(v.x) && isfinite(v.y) && isfinite(v.z);
+}
+
+Server::Server(uint16_t port) : listener(port)
+{
+    // Clients mesh their own chunks. Each update() loads the window of one client, see unload_chunks().
+    block_manager.set_meshing(false);
+    block_manager.set_unloading(false);
+    stats_start_ms = time_now_ms();
+}
+
+void Server::run(atomic<bool> const& stop)
+{
+    using namespace std::chrono;
+
+    auto next = steady_clock::now();
+    while (!stop)
+    {
+        tick();
+
+        // A tick that ran late is not made up for.
+        next = max(next + microseconds(static_cast<int64_t>(SERVER_TICK_MS * 1000.f)), steady_clock::now());
+        this_thread::sleep_until(next);
+    }
+}
+
+void Server::tick()
+{
+    using namespace std::chrono;
+    PROFILE_ZONE("Server::tick");
+
+    auto start = steady_clock::now();
+
+    while (auto connection = listener.accept())
+    {
+        clients.push_back(make_unique<Client>(Client { move(connection), next_id++ }));
+    }
+
+    for (auto& client : clients)
+    {
+        client->connection->receive([&](NetMessage type, NetReader& r) { handle(*client, type, r); });
+    }
+    clients.erase(remove_if(clients.begin(), clients.end(), [](auto const& client) { return !client->connection->is_open(); }), clients.end());
+
+    block_manager.tick(microseconds(BLOCK_TICK_BUDGET_US));
+
+    // One window per client, each with its share of the budget.
+    for (auto& client : clients)
+    {
+        if (!client->moved)
+            continue;
+        block_manager.set_range(client->range);
+        block_manager.update(client->pos, client->forward, client->velocity, microseconds(SERVER_LOAD_BUDGET_US / clients.size()));
+    }
+
+    for (auto& client : clients)
+    {
+        if (client->moved)
+            stream(*client);
+        client->connection->flush();
+    }
+
+    float ms = duration<float, milli>(steady_clock::now() - start).count();
+    stats_ticks++;
+    stats_tick_ms += ms;
+    stats_tick_max_ms = max(stats_tick_max_ms, ms);
+    if (time_now_ms() >= stats_start_ms + 1000)
+    {
+        unload_chunks();
+        send_stats();
+    }
+}
+
+void Server::shutdown()
+{
+    clients.clear();
+    block_manager.shutdown();
+}
+
+void Server::handle(Client& client, NetMessage type, NetReader& r)
+{
+    switch (type)
+    {
+        case NetMessage::hello:
+        {
+            NetWriter w {};
+            w.varint(client.id);
+            client.connection->send(NetMessage::welcome, w);
+            break;
+        }
+        case NetMessage::move:
+            client.pos      = r.vec();
+            client.forward  = r.vec();
+            client.velocity = r.vec();
+            client.range    = clamp(static_cast<int32_t>(min<uint64_t>(r.varint(), LOAD_RANGE_MAX)), LOAD_RANGE_MIN, LOAD_RANGE_MAX);
+            client.moved    = r.ok && is_finite(client.pos) && is_finite(client.forward) && is_finite(client.velocity);
+            break;
+        case NetMessage::add_block:
+        case NetMessage::del_block:
+        {
+            BlockID   block_id = r.block_id();
+            BlockData block    = type == NetMessage::add_block ? r.block() : BlockData {};
+            if (!r.ok)
+                break;
+
+            // Edits out of the client's window, or of chunks not loaded yet, are dropped.
+            ChunkID chunk_id { block_id };
+            ChunkID center_id { static_cast<int32_t>(client.pos.x), static_cast<int32_t>(client.pos.y) };
+            if (!client.moved || block_manager.get_chunk(chunk_id) == nullptr || !BlockManager::in_window(chunk_id, center_id, client.range))
+                break;
+
+            if (type == NetMessage::add_block && !block.is_null())
+                block_manager.add_block(block_id, move(block));
+            else if (type == NetMessage::del_block)
+                block_manager.del_block(block_id);
+            break;
+        }
+        default: r.ok = false; break;
+    }
+}
+
+void Server::stream(Client& client)
+{
+    PROFILE_ZONE("Server::stream");
+
+    ChunkID center_id { static_cast<int32_t>(client.pos.x), static_cast<int32_t>(client.pos.y) };
+    vec2    ahead = BlockManager::ahead_of(client.pos, client.velocity);
+    ChunkID ahead_id { static_cast<int32_t>(ahead.x), static_cast<int32_t>(ahead.y) };
+
+    // Chunks the client moved away from.
+    for (auto it = client.sent.begin(); it != client.sent.end();)
+    {
+        if (BlockManager::in_window(it->first, center_id, client.range + UNLOAD_MARGIN) || BlockManager::in_window(it->first, ahead_id, client.range + UNLOAD_MARGIN))
+        {
+            ++it;
+            continue;
+        }
+        NetWriter w {};
+        w.chunk_id(it->first);
+        client.connection->send(NetMessage::unload, w);
+        it = client.sent.erase(it);
+    }
+
+    // The loaded chunks of both windows, closest first. The client meshes a chunk once it has its neighbours, it is sent the
+    // ring the server loads past its range too.
+    int32_t                     r = BlockManager::load_range(client.range);
+    vector<pair<float, Chunk*>> chunks {};
+    array<ChunkID, 2>           windows { center_id, ahead_id };
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        for (int32_t dx = -r; dx <= r; dx++)
+        {
+            for (int32_t dy = -r; dy <= r; dy++)
+            {
+                ChunkID chunk_id = windows[i].add(dx, dy);
+                Chunk*  chunk    = block_manager.get_chunk(chunk_id);
+                if (chunk == nullptr || (i != 0 && BlockManager::in_window(chunk_id, center_id, r)))
+                    continue;
+                vec2 p { static_cast<float>(static_cast<int32_t>(chunk_id.x)) + CHUNK_WIDTH / 2.f,
+                         static_cast<float>(static_cast<int32_t>(chunk_id.y)) + CHUNK_WIDTH / 2.f };
+                chunks.emplace_back(length(p - vec2(client.pos)), chunk);
+            }
+        }
+    }
+    sort(chunks.begin(), chunks.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    // What the socket did not take yet counts against the budget, a slow client is sent less.
+    size_t    budget = SERVER_SEND_BUDGET - min(SERVER_SEND_BUDGET, client.connection->pending());
+    size_t    queued = 0;
+    NetWriter w {};
+    for (auto const& [distance, chunk] : chunks)
+    {
+        if (queued >= budget)
+            break;
+
+        auto  snapshot = chunk->snapshot();
+        auto& sent     = client.sent[chunk->chunk_id];
+        if (sent == snapshot)
+            continue;
+
+        NetMessage type = NetMessage::chunk_delta;
+        if (sent == nullptr || encode_delta(w, *sent, *snapshot) > SERVER_DELTA_MAX)
+        {
+            type = NetMessage::chunk;
+            w.data.clear();
+            encode_chunk(w, *snapshot);
+        }
+
+        queued += w.data.size();
+        client.connection->send(type, w);
+        sent = move(snapshot);
+    }
+    stats_bytes += queued;
+}
+
+void Server::unload_chunks()
+{
+    PROFILE_ZONE("Server::unload_chunks");
+
+    vector<pair<ChunkID, int32_t>> windows {};
+    for (auto const& client : clients)
+    {
+        if (!client->moved)
+            continue;
+        vec2 ahead = BlockManager::ahead_of(client->pos, client->velocity);
+        windows.emplace_back(ChunkID { static_cast<int32_t>(client->pos.x), static_cast<int32_t>(client->pos.y) }, client->range + UNLOAD_MARGIN);
+        windows.emplace_back(ChunkID { static_cast<int32_t>(ahead.x), static_cast<int32_t>(ahead.y) }, client->range + UNLOAD_MARGIN);
+    }
+
+    vector<ChunkID> far {};
+    for (Chunk const* chunk : block_manager.get_chunks())
+    {
+        if (none_of(windows.begin(), windows.end(), [&](auto const& w) { return BlockManager::in_window(chunk->chunk_id, w.first, w.second); }))
+            far.push_back(chunk->chunk_id);
+    }
+    for (ChunkID const& chunk_id : far)
+    {
+        block_manager.remove_chunk(chunk_id);
+    }
+}
+
+void Server::send_stats()
+{
+    uint64_t now = time_now_ms();
+    float    s   = static_cast<float>(now - stats_start_ms) / 1000.f;
+
+    ServerStats stats { static_cast<uint32_t>(clients.size()),
+                        stats_ticks == 0 ? 0.f : stats_tick_ms / static_cast<float>(stats_ticks),
+                        stats_tick_max_ms,
+                        static_cast<uint64_t>(static_cast<float>(stats_bytes) / s) };
+
+    NetWriter w {};
+    for (auto& client : clients)
+    {
+        w.varint(stats.n_clients);
+        w.f32(stats.tick_ms_mean);
+        w.f32(stats.tick_ms_max);
+        w.varint(stats.bytes_per_s);
+        client->connection->send(NetMessage::stats, w);
+    }
+    fprintf(stderr,
+            "%u clients, %zu chunks, tick %.2f ms mean, %.2f ms max, %.1f KiB/s sent\n",
+            stats.n_clients,
+            block_manager.get_chunks().size(),
+            stats.tick_ms_mean,
+            stats.tick_ms_max,
+            static_cast<double>(stats.bytes_per_s) / 1024.);
+
+    stats_start_ms = now;
+    stats_bytes    = 0;
+    stats_ticks    = 0;
+    stats_tick_ms = stats_tick_max_ms = 0.f;
+}
@@ -0,0 +1,70 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "net.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/*
+ * The world without a window: it loads the chunks around its clients, runs the block updates and their edits, and streams
+ * the chunks each client is near, and the blocks changed in them since, to the client.
+ */
+class Server : private NonCopy<Server>
+{
+private:
+    struct Client
+    {
+        unique_ptr<Connection> connection;
+        uint32_t               id;
+
+        // Nothing is streamed before the first move.
+        bool    moved = false;
+        vec3    pos { 0.f }, forward { 0.f }, velocity { 0.f };
+        int32_t range = BlockManager::LOAD_RANGE;
+
+        // The snapshot of each chunk as the client has it, deltas are taken against it.
+        unordered_map<ChunkID, shared_ptr<ChunkSnapshot const>, ChunkID::Hasher> sent {};
+    };
+
+    Listener                   listener;
+    BlockManager               block_manager {};
+    vector<unique_ptr<Client>> clients {};
+    uint32_t                   next_id = 1;
+
+    // Since the last stats message.
+    uint64_t stats_start_ms = 0, stats_bytes = 0;
+    uint32_t stats_ticks = 0;
+    float    stats_tick_ms = 0.f, stats_tick_max_ms = 0.f;
+
+public:
+    // Throws if port cannot be bound. DB::init() is up to the caller.
+    explicit Server(uint16_t port);
+
+    // Ticks every SERVER_TICK_MS until stop is set.
+    void run(atomic<bool> const& stop);
+
+    void tick();
+
+    // Stores the chunks in the DB, DB::shutdown() is up to the caller.
+    void shutdown();
+
+private:
+    void handle(Client& client, NetMessage type, NetReader& r);
+
+    // Sends what client is missing of the chunks around it, closest first, until SERVER_SEND_BUDGET.
+    void stream(Client& client);
+
+    // Removes the chunks no client is near, storing their edits.
+    void unload_chunks();
+
+    void send_stats();
+};
+
+#endif
@@ -31,6 +31,10 @@ void BlockShader::init()
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
     glTexStorage3D(GL_TEXTURE_2D_ARRAY, N_MIP_LEVEL, GL_RGBA8, SUB_TEX_WIDTH, SUB_TEX_HEIGHT, N_TILES);
+    for (uint32_t i = 0; i < (uint32_t) N_MIP_LEVEL; i++)
+    {
+        Memory::ins().add(MemoryCategory::gpu_textures, 4 * (SUB_TEX_WIDTH >> i) * (SUB_TEX_HEIGHT >> i) * N_TILES);
+    }
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     auto texture_data = load_texture(TEXTURE_FOLDER_PATH, 4);
     for (uint32_t i = 0; i < (uint32_t) N_MIP_LEVEL; i++)
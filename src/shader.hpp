@@ -5,6 +5,7 @@
 
 #include "config.hpp"
 #include "opengl.hpp"
+#include "profile.hpp"
 #include "util.hpp"
 
 using namespace std;
@@ -89,6 +90,7 @@ public:
 public:
     void init()
     {
+        PROFILE_ZONE("ShaderManager::init");
         block_shader.init();
         block_edge_shader.init();
         line_shader.init();
@@ -12,9 +12,9 @@
 
 #include "texture.hpp"
 
-array<vector<uint8_t>, N_MIP_LEVEL> load_texture(string tex_folder_path, int n_channels)
+array<TextureData, N_MIP_LEVEL> load_texture(string tex_folder_path, int n_channels)
 {
-    array<vector<uint8_t>, N_MIP_LEVEL> data {};
+    array<TextureData, N_MIP_LEVEL> data {};
 
     if (tex_folder_path.back() != '/')
     {
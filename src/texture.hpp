@@ -5,9 +5,13 @@
 #include <vector>
 
 #include "config.hpp"
+#include "memory.hpp"
 
 using namespace std;
 
-array<vector<uint8_t>, N_MIP_LEVEL> load_texture(string tex_folder_path, int n_channels);
+// Decoded images, counted in MemoryCategory::textures until they are freed.
+using TextureData = vector<uint8_t, TrackedAllocator<uint8_t, MemoryCategory::textures>>;
+
+array<TextureData, N_MIP_LEVEL> load_texture(string tex_folder_path, int n_channels);
 
 #endif
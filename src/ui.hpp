@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "config.hpp"
+#include "memory.hpp"
 #include "player.hpp"
 #include "shader.hpp"
 #include "util.hpp"
@@ -30,6 +31,7 @@ public:
         GLuint vbo = gen_vbo();
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * data.size(), data.data(), GL_STATIC_DRAW);
+        Memory::ins().add(MemoryCategory::gpu_buffers, static_cast<int64_t>(sizeof(GLfloat) * data.size()));
 
         vao = gen_vao();
         glBindVertexArray(vao);
@@ -151,6 +153,7 @@ public:
         GLuint vbo = gen_vbo();
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * data.size(), data.data(), GL_STATIC_DRAW);
+        Memory::ins().add(MemoryCategory::gpu_buffers, static_cast<int64_t>(sizeof(GLfloat) * data.size()));
 
         vao = gen_vao();
         glBindVertexArray(vao);
@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "net.hpp"
+
+using namespace std;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: craft-bot HOST PORT CLIENTS SECONDS\n"
+            "Connects CLIENTS players to craft-server, walking about and editing blocks, and prints the bandwidth of each\n"
+            "second and the tick time the server reports.\n");
+    exit(1);
+}
+
+static int32_t parse_int(char const* s)
+{
+    char* end = nullptr;
+    long  v   = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v <= 0)
+        usage();
+    return static_cast<int32_t>(v);
+}
+
+// A player walking in a straight line at player_speed, turning every few seconds, and placing a block and removing it
+// again now and then.
+struct Bot
+{
+    unique_ptr<NetClient> client;
+    vec3                  pos, velocity { 0.f };
+    float                 turn_ms = 0.f, edit_ms = 0.f;
+    optional<BlockID>     placed {};
+};
+
+int main(int argc, char** argv)
+{
+    using namespace std::chrono;
+
+    if (argc != 5)
+        usage();
+
+    string  host    = argv[1];
+    auto    port    = static_cast<uint16_t>(parse_int(argv[2]));
+    int32_t n_bots  = parse_int(argv[3]);
+    int32_t seconds = parse_int(argv[4]);
+
+    // Each bot moves and receives every STEP_MS.
+    constexpr float STEP_MS = 50.f;
+
+    mt19937                          rng { 1 };
+    uniform_real_distribution<float> spread { -64.f, 64.f }, angle { 0.f, 6.2831853f }, turn { 2000.f, 8000.f }, edit { 500.f, 3000.f };
+
+    vector<Bot> bots {};
+    try
+    {
+        for (int32_t i = 0; i < n_bots; i++)
+        {
+            bots.push_back(Bot { make_unique<NetClient>(host, port), vec3(spread(rng), spread(rng), 60.f) });
+        }
+    }
+    catch (exception const&)
+    {
+        return 1;
+    }
+
+    uint64_t last_down = 0, last_up = 0;
+    auto     start = steady_clock::now(), next = start;
+    for (int32_t s = 1; s <= seconds; s++)
+    {
+        for (int32_t step = 0; step < static_cast<int32_t>(1000.f / STEP_MS); step++)
+        {
+            for (Bot& bot : bots)
+            {
+                bot.client->receive(nullptr);
+
+                if ((bot.turn_ms -= STEP_MS) <= 0.f)
+                {
+                    float a      = angle(rng);
+                    bot.velocity = vec3(cos(a), sin(a), 0.f) * player_speed;
+                    bot.turn_ms  = turn(rng);
+                }
+                bot.pos += bot.velocity * STEP_MS;
+                bot.client->send_move(bot.pos, normalize(bot.velocity), bot.velocity, BlockManager::LOAD_RANGE);
+
+                if ((bot.edit_ms -= STEP_MS) <= 0.f)
+                {
+                    if (bot.placed.has_value())
+                    {
+                        bot.client->send_del_block(*bot.placed);
+                        bot.placed.reset();
+                    }
+                    else
+                    {
+                        bot.placed = BlockID { static_cast<int32_t>(floor(bot.pos.x)) + 2, static_cast<int32_t>(floor(bot.pos.y)), 100 };
+                        bot.client->send_add_block(*bot.placed, BlockData { BlockType::stone_block });
+                    }
+                    bot.edit_ms = edit(rng);
+                }
+            }
+
+            next += microseconds(static_cast<int64_t>(STEP_MS * 1000.f));
+            this_thread::sleep_until(next);
+        }
+
+        uint64_t down = 0, up = 0, n_chunks = 0, n_deltas = 0, n_open = 0;
+        for (Bot const& bot : bots)
+        {
+            down += bot.client->get_connection().bytes_received;
+            up += bot.client->get_connection().bytes_sent;
+            n_chunks += bot.client->n_chunks;
+            n_deltas += bot.client->n_deltas;
+            n_open += bot.client->is_open();
+        }
+        ServerStats const& stats = bots.front().client->stats;
+        printf("%3d s  %llu/%d open  down %8.1f KiB/s  up %6.1f KiB/s  %llu chunks  %llu deltas  server: %u clients, tick %.2f ms mean, %.2f ms max\n",
+               s,
+               static_cast<unsigned long long>(n_open),
+               n_bots,
+               static_cast<double>(down - last_down) / 1024.,
+               static_cast<double>(up - last_up) / 1024.,
+               static_cast<unsigned long long>(n_chunks),
+               static_cast<unsigned long long>(n_deltas),
+               stats.n_clients,
+               stats.tick_ms_mean,
+               stats.tick_ms_max);
+        fflush(stdout);
+        last_down = down;
+        last_up   = up;
+    }
+
+    double s = duration<double>(steady_clock::now() - start).count();
+    printf("%d clients for %.1f s: down %.1f KiB/s per client, up %.2f KiB/s per client\n",
+           n_bots,
+           s,
+           static_cast<double>(last_down) / 1024. / s / n_bots,
+           static_cast<double>(last_up) / 1024. / s / n_bots);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chunk.hpp"
+#include "db.hpp"
+#include "job.hpp"
+
+using namespace std;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: craft-pregen SEED rect X0 Y0 X1 Y1 [THREADS]\n"
+            "       craft-pregen SEED radius X Y R [THREADS]\n"
+            "Bakes the terrain of the given chunks (chunk coordinates, block / 16) into the world db.\n");
+    exit(1);
+}
+
+static int32_t parse_int(char const* s)
+{
+    char*     end = nullptr;
+    long long v   = strtoll(s, &end, 10);
+    if (end == s || *end != '\0' || v < INT32_MIN || v > INT32_MAX)
+        usage();
+    return static_cast<int32_t>(v);
+}
+
+// The seed is stored in the db, one that does not parse must not bake a world of seed 0.
+static uint32_t parse_seed(char const* s)
+{
+    char*     end = nullptr;
+    long long v   = strtoll(s, &end, 10);
+    if (end == s || *end != '\0' || v < 0 || v > UINT32_MAX)
+        usage();
+    return static_cast<uint32_t>(v);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        usage();
+
+    uint32_t seed  = parse_seed(argv[1]);
+    string   shape = argv[2];
+
+    // rect takes four coordinates, radius three; the thread count may follow.
+    int n_args = shape == "rect" ? 4 : 3;
+    if (argc != 3 + n_args && argc != 4 + n_args)
+        usage();
+
+    int32_t  a = parse_int(argv[3]), b = parse_int(argv[4]), c = parse_int(argv[5]), d = n_args == 4 ? parse_int(argv[6]) : 0;
+    uint32_t n_threads = argc == 4 + n_args ? static_cast<uint32_t>(parse_int(argv[3 + n_args])) : max(1u, thread::hardware_concurrency());
+
+    vector<ChunkID> chunk_ids {};
+    if (shape == "rect")
+    {
+        for (int32_t x = min(a, c); x <= max(a, c); x++)
+            for (int32_t y = min(b, d); y <= max(b, d); y++)
+                chunk_ids.emplace_back(x * static_cast<int32_t>(CHUNK_WIDTH), y * static_cast<int32_t>(CHUNK_WIDTH));
+    }
+    else if (shape == "radius")
+    {
+        for (int32_t x = a - c; x <= a + c; x++)
+            for (int32_t y = b - c; y <= b + c; y++)
+                if ((x - a) * (x - a) + (y - b) * (y - b) <= c * c)
+                    chunk_ids.emplace_back(x * static_cast<int32_t>(CHUNK_WIDTH), y * static_cast<int32_t>(CHUNK_WIDTH));
+    }
+    else
+    {
+        usage();
+    }
+
+    DB& db = DB::ins();
+    db.init();
+
+    // Player edits are stored relative to the terrain, which depends on the seed.
+    if (db.seed != seed && !(db.chunks.empty() && db.baked.empty()))
+    {
+        fprintf(stderr, "%s already holds a world with seed %u\n", db.path.c_str(), db.seed);
+        return 1;
+    }
+    db.seed = seed;
+
+    chunk_ids.erase(remove_if(chunk_ids.begin(), chunk_ids.end(), [&](ChunkID const& chunk_id) { return db.baked.count(chunk_id) != 0; }), chunk_ids.end());
+    if (chunk_ids.empty())
+    {
+        printf("nothing to generate\n");
+        return 0;
+    }
+
+    vector<vector<uint32_t>> baked(chunk_ids.size());
+
+    auto start = chrono::steady_clock::now();
+
+    JobSystem jobs { n_threads };
+    jobs.parallel_for(static_cast<uint32_t>(chunk_ids.size()), 1, n_threads, [&](uint32_t i) { baked[i] = Chunk::bake(chunk_ids[i]); });
+
+    auto generated = chrono::steady_clock::now();
+
+    size_t n_runs = 0;
+    for (size_t i = 0; i < chunk_ids.size(); i++)
+    {
+        n_runs += baked[i].size();
+        db.baked.emplace(chunk_ids[i], move(baked[i]));
+    }
+    db.shutdown();
+
+    auto end = chrono::steady_clock::now();
+
+    double t_gen = chrono::duration<double>(generated - start).count();
+    double t_all = chrono::duration<double>(end - start).count();
+    printf("%zu chunks on %u threads: generated in %.3f s (%.0f chunks/s), written in %.3f s (%.0f chunks/s overall), %zu bytes\n",
+           chunk_ids.size(),
+           n_threads,
+           t_gen,
+           static_cast<double>(chunk_ids.size()) / t_gen,
+           t_all - t_gen,
+           static_cast<double>(chunk_ids.size()) / t_all,
+           n_runs * sizeof(uint32_t));
+
+    return 0;
+}
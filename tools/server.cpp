@@ -0,0 +1,58 @@
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+#include "db.hpp"
+#include "server.hpp"
+
+using namespace std;
+
+static atomic<bool> stop { false };
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: craft-server [PORT]\n"
+            "Runs the world of the db without a window, for craft --connect HOST:PORT and craft-bot (port %u by default).\n",
+            SERVER_PORT);
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2)
+        usage();
+
+    uint16_t port = SERVER_PORT;
+    if (argc == 2)
+    {
+        char*         end = nullptr;
+        unsigned long v   = strtoul(argv[1], &end, 10);
+        if (end == argv[1] || *end != '\0' || v == 0 || v > 65535)
+            usage();
+        port = static_cast<uint16_t>(v);
+    }
+
+    signal(SIGINT, [](int) { stop = true; });
+    signal(SIGTERM, [](int) { stop = true; });
+
+    DB& db = DB::ins();
+    db.init();
+
+    try
+    {
+        Server server { port };
+        fprintf(stderr, "Serving %s on port %u\n", db.path.c_str(), port);
+        server.run(stop);
+        server.shutdown();
+    }
+    catch (exception const&)
+    {
+        return 1;
+    }
+
+    db.shutdown();
+    return 0;
+}